@@ -13,6 +13,7 @@ class FuncDef
   attr_reader :args
   attr_reader :args_dcl
   attr_reader :cancel_cb
+  attr_reader :breakable
 
   def initialize(key, val)
     @orig_name = key
@@ -20,19 +21,30 @@ class FuncDef
     @args = val["args"].collect do |arg|
       ArgDef.new(arg)
     end
-    breakable = (not val.has_key?("break")) || val["break"]
-    @args_dcl = if @args[0].dcl == 'dpiConn *conn' || !breakable
-                  ""
+    @breakable = (not val.has_key?("break")) || val["break"]
+    # Breakable functions take rbOraDBConn in place of dpiConn to check
+    # deadlines of the connection.
+    @args_dcl = if @breakable
+                  (['rbOraDBConn *dconn'] + wrapper_args.collect {|arg| arg.dcl}).join(', ')
                 else
-                  'dpiConn *conn, '
-                end + @args.collect {|arg| arg.dcl}.join(', ')
-    @cancel_cb = if breakable
-                   "(void (*)(void *))dpiConn_breakExecution, conn"
+                  @args.collect {|arg| arg.dcl}.join(', ')
+                end
+    @cancel_cb = if @breakable
+                   "(void (*)(void *))dpiConn_breakExecution, dconn->handle"
                  else
                    "NULL, NULL"
                  end
   end
 
+  def takes_conn?
+    @args[0].dcl == 'dpiConn *conn'
+  end
+
+  # arguments passed to the wrapper function
+  def wrapper_args
+    @breakable && takes_conn? ? @args[1..] : @args
+  end
+
   class ArgDef
     attr_reader :dcl
     attr_reader :name
@@ -51,9 +63,11 @@ class EnumDef
   attr_reader :to_dpi
   attr_reader :from_dpi
   attr_reader :values
+  attr_reader :since
   def initialize(key, val)
     @name = key
     @bitflag = val["bitflag"]
+    @since = val["since"]
     prefix = val["prefix"]
     @to_dpi = @from_dpi = false
     case val["dir"]
@@ -65,12 +79,24 @@ class EnumDef
       @to_dpi = true
       @from_dpi = true
     end
+    # A value written as "name: x.y" is available since ODPI-C x.y.
     @values = val["values"].map do |val|
-      [prefix + val.upcase, val]
+      val, since = val.first if val.is_a? Hash
+      [prefix + val.upcase, val, since]
     end
   end
 end
 
+# Encloses code available since ODPI-C +since+ in #if ... #endif.
+def since_guard(f, since)
+  if since
+    major, minor = since.to_s.split('.')
+    f.print("#if DPI_VERSION_NUMBER >= DPI_VERSION_TO_NUMBER(#{major}, #{minor}, 0)\n")
+  end
+  yield
+  f.print("#endif\n") if since
+end
+
 func_defs = []
 YAML.load(open(ext_src_dir / "dpi_funcs.yml")).each do |key, val|
   if val["args"]
@@ -90,6 +116,12 @@ open("_gen_dpi_funcs.h", 'w') do |f|
 #define DPI_FUNCS_H 1
 /* This file was created by extconf.rb */
 
+typedef struct rbOraDBConn rbOraDBConn;
+
+/* defined in rboradb_deadline.c */
+int rboradb_deadline_enter(rbOraDBConn *dconn);
+void rboradb_deadline_leave(rbOraDBConn *dconn);
+
 EOS
   func_defs.each do |func|
     f.print(<<EOS)
@@ -104,10 +136,8 @@ end
 open("_gen_dpi_funcs.c", 'w') do |f|
   f.print(<<EOS)
 /* This file was created by extconf.rb */
-#include <ruby.h>
+#include "rboradb.h"
 #include <ruby/thread.h>
-#include <dpi.h>
-#include "_gen_dpi_funcs.h"
 EOS
   func_defs.each do |func|
     f.print(<<EOS)
@@ -120,13 +150,31 @@ EOS
     #{arg.dcl};
 EOS
     end
+    f.print(<<EOS) if func.breakable
+    rbOraDBConn *dconn;
+EOS
     f.print(<<EOS)
 } #{func.orig_name}_arg_t;
 
 static void *#{func.orig_name}_cb(void *data)
 {
     #{func.orig_name}_arg_t *arg = (#{func.orig_name}_arg_t *)data;
+EOS
+    if func.breakable
+      f.print(<<EOS)
+    int rv;
+    if (rboradb_deadline_enter(arg->dconn)) {
+        return (void*)(size_t)DPI_FAILURE;
+    }
+    rv = #{func.orig_name}(#{func.args.collect {|arg| 'arg->' + arg.name}.join(', ')});
+    rboradb_deadline_leave(arg->dconn);
+EOS
+    else
+      f.print(<<EOS)
     int rv = #{func.orig_name}(#{func.args.collect {|arg| 'arg->' + arg.name}.join(', ')});
+EOS
+    end
+    f.print(<<EOS)
     return (void*)(size_t)rv;
 }
 
@@ -135,9 +183,17 @@ int #{func.name}(#{func.args_dcl})
     #{func.orig_name}_arg_t arg;
     void *rv;
 EOS
-    func.args.each do |arg|
+    func.wrapper_args.each do |arg|
       f.print(<<EOS)
     arg.#{arg.name} = #{arg.name};
+EOS
+    end
+    if func.breakable
+      f.print(<<EOS)
+    arg.dconn = dconn;
+EOS
+      f.print(<<EOS) if func.takes_conn?
+    arg.conn = dconn->handle;
 EOS
     end
     f.print(<<EOS)
@@ -171,12 +227,14 @@ typedef enum OciHandleType {
 
 EOS
   enum_defs.each do |enum|
-    f.print(<<EOS) if enum.to_dpi
+    since_guard(f, enum.since) do
+      f.print(<<EOS) if enum.to_dpi
 #{enum.name} rboradb_to_#{enum.name}(VALUE obj);
 EOS
-    f.print(<<EOS) if enum.from_dpi
+      f.print(<<EOS) if enum.from_dpi
 VALUE rboradb_from_#{enum.name}(#{enum.name} val);
 EOS
+    end
   end
   f.print(<<EOS)
 #endif
@@ -217,31 +275,35 @@ static VALUE from_bitvalues(uint32_t val, VALUE (*func)(uint32_t))
 }
 EOS
   enum_defs.each do |enum|
-    if enum.to_dpi
-      if enum.bitflag
-        f.print(<<EOS)
+    since_guard(f, enum.since) do
+      if enum.to_dpi
+        if enum.bitflag
+          f.print(<<EOS)
 
 static uint32_t to_#{enum.name}(VALUE obj)
 EOS
-      else
-        f.print(<<EOS)
+        else
+          f.print(<<EOS)
 
 #{enum.name} rboradb_to_#{enum.name}(VALUE obj)
 EOS
-      end
-        f.print(<<EOS)
+        end
+          f.print(<<EOS)
 {
     static VALUE map = Qundef;
     VALUE val;
     if (map == Qundef) {
         map = rb_hash_new();
+        rb_gc_register_mark_object(map);
 EOS
-        enum.values.each do |val|
-        f.print(<<EOS)
+          enum.values.each do |val|
+            since_guard(f, val[2]) do
+              f.print(<<EOS)
         rb_hash_aset(map, ID2SYM(rb_intern("#{val[1]}")), UINT2NUM(#{val[0]}));
 EOS
-        end
-        f.print(<<EOS)
+            end
+          end
+          f.print(<<EOS)
     }
     val = rb_hash_aref(map, obj);
     if (NIL_P(val)) {
@@ -251,53 +313,56 @@ EOS
     return NUM2UINT(val);
 }
 EOS
-      if enum.bitflag
-        f.print(<<EOS)
+        if enum.bitflag
+          f.print(<<EOS)
 
 #{enum.name} rboradb_to_#{enum.name}(VALUE obj)
 {
     return to_bitvalues(obj, to_#{enum.name});
 }
 EOS
+        end
       end
-    end
-    if enum.from_dpi
-      if enum.bitflag
-        f.print(<<EOS)
+      if enum.from_dpi
+        if enum.bitflag
+          f.print(<<EOS)
 
 static VALUE from_#{enum.name}(#{enum.name} val)
 EOS
-      else
-        f.print(<<EOS)
+        else
+          f.print(<<EOS)
 
 VALUE rboradb_from_#{enum.name}(#{enum.name} val)
 EOS
-      end
-      f.print(<<EOS)
+        end
+        f.print(<<EOS)
 {
     ID id;
     switch (val) {
 EOS
-      enum.values.each do |val|
-        f.print(<<EOS)
+        enum.values.each do |val|
+          since_guard(f, val[2]) do
+            f.print(<<EOS)
     case #{val[0]}:
         CONST_ID(id, "#{val[1]}");
         return ID2SYM(id);
 EOS
-      end
-      f.print(<<EOS)
+          end
+        end
+        f.print(<<EOS)
     }
     rb_raise(rb_eArgError, "unknown #{enum.name}: %u", val);
 }
 EOS
-      if enum.bitflag
-        f.print(<<EOS)
+        if enum.bitflag
+          f.print(<<EOS)
 
 VALUE rboradb_from_#{enum.name}(#{enum.name} val)
 {
     return from_bitvalues(val,from_#{enum.name});
 }
 EOS
+        end
       end
     end
   end
@@ -305,6 +370,9 @@ end
 
 $CFLAGS << " -I. -I#{ext_src_dir.parent.parent / "odpi" / "include"}"
 
+have_func("rb_hash_new_capa", "ruby.h")
+have_func("rb_io_descriptor", "ruby/io.h")
+
 $objs = ext_src_dir.glob("*.c").reject do |file|
   file.basename.to_s.start_with?("_gen_")
 end.map do |file|
@@ -16,6 +16,7 @@
 
 static VALUE cContext;
 static VALUE eError;
+static VALUE eTimeoutError;
 
 typedef struct {
     rbOraDBContext *ctxt;
@@ -30,17 +31,22 @@ static void context_free(void *arg)
     xfree(arg);
 }
 
+static size_t context_memsize(const void *arg)
+{
+    return sizeof(context_t) + sizeof(rbOraDBContext);
+}
+
 static const struct rb_data_type_struct context_data_type = {
     "OracleDB::Context",
-    {NULL, context_free,},
-    NULL, NULL,
+    {NULL, context_free, context_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
-VALUE rboradb_from_dpiErrorInfo(const dpiErrorInfo *error)
+static VALUE exc_from_dpiErrorInfo(VALUE klass, const dpiErrorInfo *error)
 {
     rb_encoding *enc = rb_enc_find(error->encoding);
     VALUE message = rb_enc_str_new(error->message, error->messageLength, enc);
-    VALUE exc = rb_exc_new_str(eError, message);
+    VALUE exc = rb_exc_new_str(klass, message);
 
     rb_iv_set(exc, "code", INT2NUM(error->code));
     rb_iv_set(exc, "offset", UINT2NUM(error->offset));
@@ -52,6 +58,11 @@ VALUE rboradb_from_dpiErrorInfo(const dpiErrorInfo *error)
     return exc;
 }
 
+VALUE rboradb_from_dpiErrorInfo(const dpiErrorInfo *error)
+{
+    return exc_from_dpiErrorInfo(eError, error);
+}
+
 static VALUE context_alloc(VALUE klass)
 {
     context_t *ctxt;
@@ -118,6 +129,39 @@ void rboradb_raise_error(rbOraDBContext *ctxt)
     rb_exc_raise(rboradb_from_dpiErrorInfo(&error));
 }
 
+void rboradb_raise_conn_error(rbOraDBConn *dconn)
+{
+    dpiErrorInfo error;
+
+    dpiContext_getError(dconn->ctxt->handle, &error);
+    rboradb_raise_conn_error_info(dconn, &error);
+}
+
+// Same as rboradb_raise_conn_error() but with error information got
+// in another thread.
+void rboradb_raise_conn_error_info(rbOraDBConn *dconn, const dpiErrorInfo *info)
+{
+    static const char msg[] = "ORA-01013: user requested cancel of current operation";
+    dpiErrorInfo error;
+
+    switch (rboradb_deadline_expired(dconn)) {
+    case RBORADB_DEADLINE_BROKEN:
+        rb_exc_raise(exc_from_dpiErrorInfo(eTimeoutError, info));
+    case RBORADB_DEADLINE_SKIPPED:
+        // The call didn't reach ODPI-C. Make an error as if it was broken.
+        memset(&error, 0, sizeof(error));
+        error.code = 1013;
+        error.message = msg;
+        error.messageLength = sizeof(msg) - 1;
+        error.encoding = "UTF-8";
+        error.fnName = "";
+        error.action = "";
+        error.sqlState = "HY008";
+        rb_exc_raise(exc_from_dpiErrorInfo(eTimeoutError, &error));
+    }
+    rb_exc_raise(rboradb_from_dpiErrorInfo(info));
+}
+
 VALUE rboradb_notimplement(int argc, VALUE *argv, VALUE self)
 {
     rb_notimplement();
@@ -135,6 +179,8 @@ void Init_oracledb()
     rb_define_attr(eError, "sql_state", 1, 0);
     rb_define_attr(eError, "is_recoverable", 1, 0);
 
+    eTimeoutError = rb_define_class_under(mOracleDB, "TimeoutError", eError);
+
     cContext = rb_define_class_under(mOracleDB, "Context", rb_cObject);
     rb_define_alloc_func(cContext, context_alloc);
     rb_define_method(cContext, "initialize", context_initialize, -1);
@@ -143,8 +189,11 @@ void Init_oracledb()
 
     rboradb_aq_init(mOracleDB);
     rboradb_conn_init(mOracleDB);
+    rboradb_copy_init(mOracleDB);
     rboradb_data_init();
     rboradb_datetime_init(mOracleDB);
+    rboradb_deadline_init();
+    rboradb_filter_init();
     rboradb_info_types_init(mOracleDB);
     rboradb_json_init(mOracleDB);
     rboradb_lob_init(mOracleDB);
@@ -156,4 +205,5 @@ void Init_oracledb()
     rboradb_stmt_init(mOracleDB);
     rboradb_subscr_init(mOracleDB);
     rboradb_var_init(mOracleDB);
+    rboradb_vector_init(mOracleDB);
 }
@@ -18,10 +18,15 @@
 #include <ruby.h>
 #include <ruby/atomic.h>
 #include <ruby/encoding.h>
+#include <ruby/thread_native.h>
 #include "dpi.h"
 #include "_gen_dpi_funcs.h"
 #include "_gen_dpi_enums.h"
 
+#if DPI_VERSION_NUMBER >= DPI_VERSION_TO_NUMBER(5, 3, 0)
+#define RBORADB_HAVE_VECTOR 1 // VECTOR data type of Oracle 23ai
+#endif
+
 #define RBORADB_COMMON_HEADER(type) \
     type *handle; \
     rbOraDBConn *dconn
@@ -56,30 +61,67 @@
 } while (0)
 
 #define RBORADB_RAISE_ERROR(var_) do { \
-    rboradb_raise_error((var_)->dconn->ctxt); \
+    rboradb_raise_conn_error((var_)->dconn); \
 } while (0)
 
 #define rb_define_method_nodoc rb_define_method
 
+// Flags of rb_data_type_t for wrappers whose structs refer to no Ruby
+// object or write references only through RB_OBJ_WRITE().
+#define RBORADB_TYPED_FLAGS (RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED)
+// Same but for wrappers whose dfree may make round trips to the server,
+// such as closing a connection or a pool, a cursor or a temporary LOB.
+// They are freed after the GC finishes, not during it.
+#define RBORADB_TYPED_DEFERRED_FLAGS (RUBY_TYPED_WB_PROTECTED)
+
 typedef struct {
     rb_atomic_t refcnt;
     dpiContext *handle;
 } rbOraDBContext;
 
+#define RBORADB_TZ_CACHE_SIZE 64 // must be a power of two
+#define RBORADB_TZ_MAX_LEN 128
+
+// UTC offsets of local time cached by hours
 typedef struct {
+    int64_t hours[RBORADB_TZ_CACHE_SIZE]; // hours since the epoch in local time plus one or zero
+    int32_t offsets[RBORADB_TZ_CACHE_SIZE];
+    int tz_isset;
+    char tz[RBORADB_TZ_MAX_LEN]; // TZ environment variable when offsets are cached
+} rbOraDBTzCache;
+
+// typedef'ed in _gen_dpi_funcs.h
+struct rbOraDBConn {
     rb_atomic_t refcnt;
     dpiConn *handle;
     rbOraDBContext *ctxt;
-} rbOraDBConn;
+    rbOraDBTzCache *tz_cache; // allocated on first use
+    st_table *objtype_cache; // object type metadata in rboradb_object.c
+    // members below are protected by the heap lock in rboradb_deadline.c
+    uint64_t deadline_at; // in milliseconds of the monotonic clock
+    long deadline_idx; // index in the deadline heap or -1
+    volatile int deadline_set; // read without locks by breakable calls
+    // written with both the heap lock and deadline_lock, read with either
+    int deadline_expired;
+    // members below are protected by deadline_lock
+    rb_nativethread_lock_t deadline_lock;
+    int deadline_in_call; // a breakable ODPI-C call is running
+    int deadline_broken; // RBORADB_DEADLINE_BROKEN or RBORADB_DEADLINE_SKIPPED
+};
+
+// the last breakable call was broken by the deadline
+#define RBORADB_DEADLINE_BROKEN 1
+// the last breakable call wasn't started because the deadline had passed
+#define RBORADB_DEADLINE_SKIPPED 2
 
 #define ExportString(s) do { \
     SafeStringValue(s); \
-    s = rb_str_export_to_enc(s, rb_utf8_encoding());	\
+    s = rboradb_export_utf8(s); \
 } while (0)
 #define OptExportString(s) do { \
     if (!NIL_P(s)) { \
         SafeStringValue(s); \
-        s = rb_str_export_to_enc(s, rb_utf8_encoding()); \
+        s = rboradb_export_utf8(s); \
     } \
 } while (0)
 #define OPT_RSTRING_PTR(s) ((NIL_P(s)) ? NULL : RSTRING_PTR(s))
@@ -156,11 +198,18 @@ static inline void rbOraDBConn_addRef(rbOraDBConn *dconn)
     RUBY_ATOMIC_INC(dconn->refcnt);
 }
 
+void rboradb_free_objtype_cache(st_table *cache);
+
 static inline void rbOraDBConn_release(rbOraDBConn *dconn)
 {
     if (RUBY_ATOMIC_FETCH_SUB(dconn->refcnt, 1) == 1) {
+        if (dconn->objtype_cache) {
+            rboradb_free_objtype_cache(dconn->objtype_cache);
+        }
         dpiConn_release(dconn->handle);
         rbOraDBContext_release(dconn->ctxt);
+        rb_native_mutex_destroy(&dconn->deadline_lock);
+        xfree(dconn->tz_cache);
         xfree(dconn);
     }
 }
@@ -170,6 +219,8 @@ rbOraDBContext *rboradb_get_rbOraDBContext(VALUE obj);
 rbOraDBConn *rboradb_get_dconn(VALUE obj);
 VALUE rboradb_from_dpiErrorInfo(const dpiErrorInfo *error);
 NORETURN(void rboradb_raise_error(rbOraDBContext *ctxt));
+NORETURN(void rboradb_raise_conn_error(rbOraDBConn *dconn));
+NORETURN(void rboradb_raise_conn_error_info(rbOraDBConn *dconn, const dpiErrorInfo *info));
 VALUE rboradb_notimplement(int argc, VALUE *argv, VALUE self);
 
 // rboradb_aq.c
@@ -180,12 +231,24 @@ void rboradb_conn_init(VALUE mOracleDB);
 rbOraDBConn *rboradb_get_dconn_in_conn(VALUE obj);
 VALUE rboradb_to_conn(rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCreateParams *params);
 
+// rboradb_copy.c
+void rboradb_copy_init(VALUE mOracleDB);
+
 // rboradb_data.c
 void rboradb_data_init(void);
+VALUE rboradb_enc_str_new(const char *ptr, long len, rb_encoding *enc);
+VALUE rboradb_export_utf8(VALUE str);
+rb_encoding *rboradb_bytes_encoding(dpiOracleTypeNum oracle_type_num);
 VALUE rboradb_from_data(const dpiData *data, dpiNativeTypeNum native_type_num, dpiOracleTypeNum oracle_type_num, dpiObjectType *objtype, VALUE filter, rbOraDBConn *dconn);
 VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum native_type_num, dpiOracleTypeNum oracle_type_num, dpiObjectType *objtype, VALUE *filter, rbOraDBConn *dconn);
 VALUE rboradb_set_data(VALUE obj, dpiData *data, dpiNativeTypeNum native_type_num, dpiOracleTypeNum oracle_type_num, rbOraDBConn *dconn, dpiVar *var, uint32_t pos);
 
+// rboradb_deadline.c
+void rboradb_deadline_init(void);
+VALUE rboradb_push_deadline(VALUE self, VALUE secs);
+VALUE rboradb_pop_deadline(VALUE self, VALUE prev);
+int rboradb_deadline_expired(rbOraDBConn *dconn);
+
 // rboradb_datetime.c
 void rboradb_datetime_init(VALUE mOracleDB);
 VALUE rboradb_from_dpiTimestamp(const dpiTimestamp *val);
@@ -197,6 +260,20 @@ dpiIntervalYM *rboradb_to_dpiIntervalYM(VALUE obj);
 int rboradb_is_Timestamp(VALUE obj);
 int rboradb_is_IntervalDS(VALUE obj);
 int rboradb_is_IntervalYM(VALUE obj);
+#define RBORADB_TZ_LOCAL 0 // regards values as local time
+#define RBORADB_TZ_UTC 1 // regards values as UTC
+#define RBORADB_TZ_OFFSET 2 // uses the time zone offsets in values
+VALUE rboradb_timestamp_to_time(const dpiTimestamp *val, int tz, int utc, rbOraDBConn *dconn);
+int64_t rboradb_timestamp_to_epoch(const dpiTimestamp *val, int tz, rbOraDBConn *dconn);
+VALUE rboradb_time_to_timestamp(VALUE time);
+
+// rboradb_filter.c
+void rboradb_filter_init(void);
+VALUE rboradb_to_filter(VALUE filter, dpiNativeTypeNum native_type_num, int in);
+VALUE rboradb_filter_bytes(VALUE filter, const char *ptr, uint32_t len, rb_encoding *enc);
+VALUE rboradb_filter_timestamp(VALUE filter, const dpiTimestamp *val, dpiOracleTypeNum oracle_type_num, rbOraDBConn *dconn);
+VALUE rboradb_number_to_text(VALUE obj);
+VALUE rboradb_apply_filter(VALUE filter, VALUE obj, int in);
 
 // rboradb_info_types.c
 void rboradb_info_types_init(VALUE mOracleDB);
@@ -208,9 +285,13 @@ VALUE rboradb_from_dpiStmtInfo(const dpiStmtInfo *info);
 VALUE rboradb_from_dpiVersionInfo(const dpiVersionInfo *info);
 
 // rboradb_json.c
+#define RBORADB_JSON_SYMBOLIZE_NAMES 0x01
+#define RBORADB_JSON_TEXT 0x02
 void rboradb_json_init(VALUE mOracleDB);
-VALUE rboradb_dpiJson2ruby(dpiJson *handle, rbOraDBConn *dconn);
+VALUE rboradb_from_dpiJson(dpiJson *handle, rbOraDBConn *dconn);
+VALUE rboradb_dpiJson2ruby(dpiJson *handle, rbOraDBConn *dconn, int flags);
 void rboradb_ruby2dpiJson(VALUE obj, dpiJson *handle, rbOraDBConn *dconn);
+void rboradb_text2dpiJson(VALUE text, dpiJson *handle, rbOraDBConn *dconn);
 
 // rboradb_lob.c
 void rboradb_lob_init(VALUE mOracleDB);
@@ -224,6 +305,8 @@ VALUE rboradb_from_dpiObjectType(dpiObjectType *handle, rbOraDBConn *dconn, int
 dpiObjectType *rboradb_get_ObjectType_or_null(VALUE obj);
 dpiObject *rboradb_to_dpiObject(VALUE obj);
 dpiObjectType *rboradb_to_dpiObjectType(VALUE obj);
+VALUE rboradb_dpiObject_to_struct(dpiObject *handle, dpiObjectType *objtype, rbOraDBConn *dconn);
+VALUE rboradb_to_object(VALUE value, dpiObjectType *objtype, rbOraDBConn *dconn);
 
 // rboradb_params.c
 void rboradb_params_init(void);
@@ -238,6 +321,7 @@ VALUE rboradb_set_dpiSubscrCreateParams(dpiSubscrCreateParams *params, VALUE has
 void rboradb_pool_init(VALUE mOracleDB);
 
 // rboradb_rowid.c
+#define RBORADB_ROWID_SIZE 18 // length of extended rowid strings
 void rboradb_rowid_init(VALUE mOracleDB);
 VALUE rboradb_from_dpiRowid(dpiRowid *handle, rbOraDBConn *dconn, int ref);
 dpiRowid *rboradb_to_dpiRowid(VALUE obj);
@@ -259,4 +343,11 @@ void rboradb_subscr_init(VALUE mOracleDB);
 void rboradb_var_init(VALUE mOracleDB);
 dpiVar *rboradb_to_dpiVar(VALUE obj);
 
+// rboradb_vector.c
+void rboradb_vector_init(VALUE mOracleDB);
+#ifdef RBORADB_HAVE_VECTOR
+VALUE rboradb_from_dpiVector(dpiVector *handle, rbOraDBConn *dconn);
+dpiVector *rboradb_to_dpiVector(VALUE obj, rbOraDBConn *dconn);
+#endif
+
 #endif
@@ -49,10 +49,15 @@ static void deqopts_free(void *arg)
     xfree(arg);
 }
 
+static size_t deqopts_memsize(const void *arg)
+{
+    return sizeof(DeqOptions_t);
+}
+
 static const struct rb_data_type_struct deqopts_data_type = {
     "OracleDB::DeqOptions",
-    {NULL, deqopts_free,},
-    NULL, NULL,
+    {NULL, deqopts_free, deqopts_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static void enq_options_free(void *arg)
@@ -62,10 +67,15 @@ static void enq_options_free(void *arg)
     xfree(arg);
 }
 
+static size_t enq_options_memsize(const void *arg)
+{
+    return sizeof(EnqOptions_t);
+}
+
 static const struct rb_data_type_struct enq_options_data_type = {
     "OracleDB::EnqOptions",
-    {NULL, enq_options_free,},
-    NULL, NULL,
+    {NULL, enq_options_free, enq_options_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static void msg_props_free(void *arg)
@@ -78,10 +88,15 @@ static void msg_props_free(void *arg)
     xfree(arg);
 }
 
+static size_t msg_props_memsize(const void *arg)
+{
+    return sizeof(MsgProps_t);
+}
+
 static const struct rb_data_type_struct msg_props_data_type = {
     "OracleDB::MsgProps",
-    {NULL, msg_props_free,},
-    NULL, NULL,
+    {NULL, msg_props_free, msg_props_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static void queue_free(void *arg)
@@ -94,10 +109,15 @@ static void queue_free(void *arg)
     xfree(arg);
 }
 
+static size_t queue_memsize(const void *arg)
+{
+    return sizeof(Queue_t);
+}
+
 static const struct rb_data_type_struct queue_data_type = {
     "OracleDB::Queue",
-    {NULL, queue_free,},
-    NULL, NULL,
+    {NULL, queue_free, queue_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE deqopts_alloc(VALUE klass)
@@ -459,7 +479,7 @@ static VALUE queue_deq_many(VALUE self, VALUE maxnum)
     dpiMsgProps **handles = RB_ALLOCV_N(dpiMsgProps *, tmp_buf, num_props);
     VALUE ary;
 
-    if (rbOraDBQueue_deqMany(queue->dconn->handle, queue->handle, &num_props, handles) != DPI_SUCCESS) {
+    if (rbOraDBQueue_deqMany(queue->dconn, queue->handle, &num_props, handles) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(queue);
     }
     ary = rb_ary_new_capa(num_props);
@@ -475,7 +495,7 @@ static VALUE queue_deq_one(VALUE self)
     Queue_t *queue = To_Queue(self);
     dpiMsgProps *handle;
 
-    if (rbOraDBQueue_deqOne(queue->dconn->handle, queue->handle, &handle) != DPI_SUCCESS) {
+    if (rbOraDBQueue_deqOne(queue->dconn, queue->handle, &handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(queue);
     }
     return msg_props_new(handle, queue->dconn, queue->payload_objtype);
@@ -494,7 +514,7 @@ static VALUE queue_enq_many(VALUE self, VALUE props)
     for (idx = 0; idx < num_props; idx++) {
         handles[idx] = To_MsgProps(props)->handle;
     }
-    if (rbOraDBQueue_enqMany(queue->dconn->handle, queue->handle, num_props, handles) != DPI_SUCCESS) {
+    if (rbOraDBQueue_enqMany(queue->dconn, queue->handle, num_props, handles) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(queue);
     }
     RB_ALLOCV_END(tmp_buf);
@@ -506,7 +526,7 @@ static VALUE queue_enq_one(VALUE self, VALUE props)
     Queue_t *queue = To_Queue(self);
     MsgProps_t *mp = To_MsgProps(props);
 
-    if (rbOraDBQueue_enqOne(queue->dconn->handle, queue->handle, mp->handle) != DPI_SUCCESS) {
+    if (rbOraDBQueue_enqOne(queue->dconn, queue->handle, mp->handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(queue);
     }
     return Qnil;
@@ -25,12 +25,12 @@ typedef struct conn {
     VALUE new_session;
 } Conn_t;
 
-static void init_conn(Conn_t *conn, rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCreateParams *params);
+static void init_conn(VALUE self, Conn_t *conn, rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCreateParams *params);
 
 static void conn_mark(void *arg)
 {
     Conn_t *conn = (Conn_t *)arg;
-    rb_gc_mark(conn->tag);
+    rb_gc_mark_movable(conn->tag);
 }
 
 static void conn_free(void *arg)
@@ -43,10 +43,33 @@ static void conn_free(void *arg)
     xfree(arg);
 }
 
+static size_t conn_memsize(const void *arg)
+{
+    const Conn_t *conn = (const Conn_t *)arg;
+    size_t size = sizeof(Conn_t);
+
+    if (conn->dconn) {
+        size += sizeof(rbOraDBConn);
+        if (conn->dconn->tz_cache) {
+            size += sizeof(rbOraDBTzCache);
+        }
+        if (conn->dconn->objtype_cache) {
+            size += st_memsize(conn->dconn->objtype_cache);
+        }
+    }
+    return size;
+}
+
+static void conn_compact(void *arg)
+{
+    Conn_t *conn = (Conn_t *)arg;
+    conn->tag = rb_gc_location(conn->tag);
+}
+
 static const struct rb_data_type_struct conn_data_type = {
     "OracleDB::Conn",
-    {conn_mark, conn_free,},
-    NULL, NULL,
+    {conn_mark, conn_free, conn_memsize, conn_compact,},
+    NULL, NULL, RBORADB_TYPED_DEFERRED_FLAGS,
 };
 
 static VALUE conn_alloc(VALUE klass)
@@ -83,7 +106,7 @@ static VALUE conn_initialize(int argc, VALUE *argv, VALUE self)
         rboradb_raise_error(ctxt);
     }
     RB_GC_GUARD(gc_guard);
-    init_conn(conn, ctxt, dpi_conn, &conn_params);
+    init_conn(self, conn, ctxt, dpi_conn, &conn_params);
     return Qnil;
 }
 
@@ -91,18 +114,20 @@ VALUE rboradb_to_conn(rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCrea
 {
     Conn_t *conn;
     VALUE obj = TypedData_Make_Struct(cConn, Conn_t, &conn_data_type, conn);
-    init_conn(conn, ctxt, dpi_conn, params);
+    init_conn(obj, conn, ctxt, dpi_conn, params);
     return obj;
 }
 
-static void init_conn(Conn_t *conn, rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCreateParams *params)
+static void init_conn(VALUE self, Conn_t *conn, rbOraDBContext *ctxt, dpiConn* dpi_conn, const dpiConnCreateParams *params)
 {
     conn->dconn = RB_ZALLOC(rbOraDBConn);
     conn->dconn->refcnt = 1;
     conn->dconn->ctxt = ctxt;
     conn->dconn->handle = dpi_conn;
+    conn->dconn->deadline_idx = -1;
+    rb_native_mutex_initialize(&conn->dconn->deadline_lock);
     rbOraDBContext_addRef(ctxt);
-    conn->tag = rb_external_str_new_with_enc(params->outTag, params->outTagLength, rb_utf8_encoding());
+    RB_OBJ_WRITE(self, &conn->tag, rb_external_str_new_with_enc(params->outTag, params->outTagLength, rb_utf8_encoding()));
     conn->tag_found = params->outTagFound ? Qtrue : Qfalse;
     conn->new_session = params->outNewSession ? Qtrue : Qfalse;
 }
@@ -113,7 +138,7 @@ static VALUE conn_begin_distrib_trans(VALUE self, VALUE format_id, VALUE transac
 
     SafeStringValue(transaction_id);
     SafeStringValue(branch_id);
-    if (rbOraDBConn_beginDistribTrans(conn->dconn->handle, NUM2LONG(format_id),
+    if (rbOraDBConn_beginDistribTrans(conn->dconn, NUM2LONG(format_id),
                                     RSTRING_PTR(transaction_id), RSTRING_LEN(transaction_id),
                                     RSTRING_PTR(branch_id), RSTRING_LEN(branch_id)) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
@@ -138,7 +163,7 @@ static VALUE conn_change_password(VALUE self, VALUE username, VALUE old_password
     ExportString(username);
     ExportString(old_password);
     ExportString(new_password);
-    if (rbOraDBConn_changePassword(conn->dconn->handle,
+    if (rbOraDBConn_changePassword(conn->dconn,
                                  RSTRING_PTR(username), RSTRING_LEN(username),
                                  RSTRING_PTR(old_password), RSTRING_LEN(old_password),
                                  RSTRING_PTR(new_password), RSTRING_LEN(new_password)) != DPI_SUCCESS) {
@@ -155,7 +180,7 @@ static VALUE conn_close(int argc, VALUE *argv, VALUE self)
 
     rb_scan_args(argc, argv, "02", &mode, &tag);
     OptExportString(tag);
-    if (rbOraDBConn_close(conn->dconn->handle, rboradb_to_dpiConnCloseMode(mode),
+    if (rbOraDBConn_close(conn->dconn, rboradb_to_dpiConnCloseMode(mode),
                         OPT_RSTRING_PTR(tag), OPT_RSTRING_LEN(tag)) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
@@ -166,7 +191,7 @@ static VALUE conn_commit(VALUE self)
 {
     Conn_t *conn = To_Conn(self);
 
-    if (rbOraDBConn_commit(conn->dconn->handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_commit(conn->dconn) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     return Qnil;
@@ -297,7 +322,7 @@ static VALUE conn_ping(VALUE self)
 {
     Conn_t *conn = To_Conn(self);
 
-    if (rbOraDBConn_ping(conn->dconn->handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_ping(conn->dconn) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     return Qnil;
@@ -308,7 +333,7 @@ static VALUE conn_prepare_distrib_trans(VALUE self)
     Conn_t *conn = To_Conn(self);
     int commit_needed;
 
-    if (rbOraDBConn_prepareDistribTrans(conn->dconn->handle, &commit_needed) != DPI_SUCCESS) {
+    if (rbOraDBConn_prepareDistribTrans(conn->dconn, &commit_needed) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     return commit_needed ? Qtrue : Qfalse;
@@ -335,7 +360,7 @@ static VALUE conn_rollback(VALUE self)
 {
     Conn_t *conn = To_Conn(self);
 
-    if (rbOraDBConn_rollback(conn->dconn->handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_rollback(conn->dconn) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     return Qnil;
@@ -478,7 +503,7 @@ static VALUE conn_shutdown_database(VALUE self, VALUE mode)
 {
     Conn_t *conn = To_Conn(self);
 
-    if (rbOraDBConn_shutdownDatabase(conn->dconn->handle, rboradb_to_dpiShutdownMode(mode)) != DPI_SUCCESS) {
+    if (rbOraDBConn_shutdownDatabase(conn->dconn, rboradb_to_dpiShutdownMode(mode)) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     return Qnil;
@@ -491,7 +516,7 @@ static VALUE conn_startup_database(int argc, VALUE *argv, VALUE self)
 
     rb_scan_args(argc, argv, "11", &mode, &pfile);
     OptExportString(pfile);
-    if (rbOraDBConn_startupDatabaseWithPfile(conn->dconn->handle, OPT_RSTRING_PTR(pfile), OPT_RSTRING_LEN(pfile), rboradb_to_dpiShutdownMode(mode)) != DPI_SUCCESS) {
+    if (rbOraDBConn_startupDatabaseWithPfile(conn->dconn, OPT_RSTRING_PTR(pfile), OPT_RSTRING_LEN(pfile), rboradb_to_dpiShutdownMode(mode)) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(conn);
     }
     RB_GC_GUARD(pfile);
@@ -522,6 +547,8 @@ void rboradb_conn_init(VALUE mOracleDB)
     rb_define_method(cConn, "ping", conn_ping, 0);
     rb_define_method(cConn, "prepare_distrib_trans", conn_prepare_distrib_trans, 0);
     rb_define_private_method(cConn, "__prepare_stmt", conn___prepare_stmt, 4);
+    rb_define_private_method(cConn, "__push_deadline", rboradb_push_deadline, 1);
+    rb_define_private_method(cConn, "__pop_deadline", rboradb_pop_deadline, 1);
     rb_define_method(cConn, "rollback", conn_rollback, 0);
     rb_define_method(cConn, "action=", conn_set_action, 1);
     rb_define_method(cConn, "call_timeout=", conn_set_call_timeout, 1);
@@ -0,0 +1,399 @@
+// ruby-oracledb - Ruby binding for Oracle database based on ODPI-C
+//
+// URL: https://github.com/kubo/ruby-oracledb
+//
+//-----------------------------------------------------------------------------
+// Copyright (c) 2021 Kubo Takehiro <kubo@jiubao.org>. All rights reserved.
+// This program is free software: you can modify it and/or redistribute it
+// under the terms of:
+//
+// (i)  the Universal Permissive License v 1.0 or at your option, any
+//      later version (http://oss.oracle.com/licenses/upl); and/or
+//
+// (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
+//-----------------------------------------------------------------------------
+#include "rboradb.h"
+#include "ruby/thread.h"
+#include "ruby/thread_native.h"
+
+// Rows are copied from a query to array DML without ruby objects.
+// The calling thread fetches rows into define variables and copies them
+// into one of two sets of bind variables. Another ruby thread executes
+// the insert statement with the other set meanwhile. Both run without GVL.
+// Deadlines of both connections apply to the fetches and inserts.
+// Interrupts break only the connection in a call, because a break sent
+// to an idle connection would fail its next call.
+
+typedef struct {
+    int has_error;
+    rbOraDBConn *dconn; // the connection where the call failed
+    dpiErrorInfo info;
+    char message[1024];
+    char sql_state[6];
+} copy_error_t;
+
+typedef struct {
+    rbOraDBConn *src_dconn;
+    dpiStmt *src_stmt;
+    rbOraDBConn *dst_dconn;
+    dpiStmt *dst_stmt;
+    uint32_t num_cols;
+    uint32_t batch_rows;
+    uint32_t orig_fetch_array_size; // restored after the copy or zero
+    dpiVar **src_vars;
+    dpiVar **dst_vars[2];
+    VALUE consumer;
+    int completed;
+    // members below are protected by the lock
+    rb_nativethread_lock_t lock;
+    rb_nativethread_cond_t cond;
+    uint32_t num_rows[2]; // rows copied to dst_vars[idx] and not inserted yet
+    int producer_done;
+    int cancelled;
+    int src_in_call; // the producer is in dpiStmt_fetchRows()
+    int dst_in_call; // the consumer is in dpiStmt_executeMany()
+    uint64_t row_count;
+    copy_error_t error;
+} copy_t;
+
+// This must be called in the thread where the dpi function failed
+// because error information in ODPI-C is thread-local. +has_info+ is
+// false when the call was skipped by the deadline.
+static void set_error(copy_t *copy, rbOraDBConn *dconn, int has_info)
+{
+    dpiErrorInfo info = {0,};
+
+    if (has_info) {
+        dpiContext_getError(dconn->ctxt->handle, &info);
+    }
+    rb_native_mutex_lock(&copy->lock);
+    if (!copy->error.has_error) {
+        copy_error_t *err = &copy->error;
+        uint32_t len = info.messageLength < sizeof(err->message) ? info.messageLength : sizeof(err->message);
+
+        err->has_error = 1;
+        err->dconn = dconn;
+        err->info = info;
+        if (len > 0) {
+            memcpy(err->message, info.message, len);
+        }
+        err->info.message = err->message;
+        err->info.messageLength = len;
+        strncpy(err->sql_state, info.sqlState ? info.sqlState : "", sizeof(err->sql_state) - 1);
+        err->info.sqlState = err->sql_state;
+    }
+    copy->cancelled = 1;
+    rb_native_cond_broadcast(&copy->cond);
+    rb_native_mutex_unlock(&copy->lock);
+}
+
+// The lock is kept while breaking so that the call doesn't return
+// meanwhile and leave the break pending.
+static void copy_ubf(void *arg)
+{
+    copy_t *copy = (copy_t *)arg;
+
+    rb_native_mutex_lock(&copy->lock);
+    copy->cancelled = 1;
+    rb_native_cond_broadcast(&copy->cond);
+    if (copy->src_in_call) {
+        dpiConn_breakExecution(copy->src_dconn->handle);
+    }
+    if (copy->dst_in_call) {
+        dpiConn_breakExecution(copy->dst_dconn->handle);
+    }
+    rb_native_mutex_unlock(&copy->lock);
+}
+
+// Marks the start of a breakable call on +dconn+. It returns false when
+// the call must not run because the copy is cancelled or the deadline
+// of +dconn+ has passed.
+static int enter_call(copy_t *copy, rbOraDBConn *dconn, int *in_call)
+{
+    int cancelled;
+
+    if (rboradb_deadline_enter(dconn)) {
+        set_error(copy, dconn, 0);
+        return 0;
+    }
+    rb_native_mutex_lock(&copy->lock);
+    cancelled = copy->cancelled;
+    *in_call = !cancelled;
+    rb_native_mutex_unlock(&copy->lock);
+    if (cancelled) {
+        rboradb_deadline_leave(dconn);
+    }
+    return !cancelled;
+}
+
+static void leave_call(copy_t *copy, rbOraDBConn *dconn, int *in_call)
+{
+    rb_native_mutex_lock(&copy->lock);
+    *in_call = 0;
+    rb_native_mutex_unlock(&copy->lock);
+    rboradb_deadline_leave(dconn);
+}
+
+static void *produce(void *arg)
+{
+    copy_t *copy = (copy_t *)arg;
+    int idx = 0;
+    int more_rows = 1;
+
+    while (more_rows) {
+        uint32_t buffer_row_index, num_rows, row, col;
+        int rv;
+
+        if (!enter_call(copy, copy->src_dconn, &copy->src_in_call)) {
+            break;
+        }
+        rv = dpiStmt_fetchRows(copy->src_stmt, copy->batch_rows, &buffer_row_index, &num_rows, &more_rows);
+        leave_call(copy, copy->src_dconn, &copy->src_in_call);
+        if (rv != DPI_SUCCESS) {
+            set_error(copy, copy->src_dconn, 1);
+            break;
+        }
+        if (num_rows == 0) {
+            continue;
+        }
+        rb_native_mutex_lock(&copy->lock);
+        while (copy->num_rows[idx] != 0 && !copy->cancelled) {
+            rb_native_cond_wait(&copy->cond, &copy->lock);
+        }
+        rb_native_mutex_unlock(&copy->lock);
+        if (copy->cancelled) {
+            break;
+        }
+        for (col = 0; col < copy->num_cols; col++) {
+            for (row = 0; row < num_rows; row++) {
+                if (dpiVar_copyData(copy->dst_vars[idx][col], row, copy->src_vars[col], buffer_row_index + row) != DPI_SUCCESS) {
+                    set_error(copy, copy->dst_dconn, 1);
+                    return NULL;
+                }
+            }
+        }
+        rb_native_mutex_lock(&copy->lock);
+        copy->num_rows[idx] = num_rows;
+        rb_native_cond_broadcast(&copy->cond);
+        rb_native_mutex_unlock(&copy->lock);
+        idx ^= 1;
+    }
+    rb_native_mutex_lock(&copy->lock);
+    copy->producer_done = 1;
+    rb_native_cond_broadcast(&copy->cond);
+    rb_native_mutex_unlock(&copy->lock);
+    return NULL;
+}
+
+static void *consume(void *arg)
+{
+    copy_t *copy = (copy_t *)arg;
+    int idx = 0;
+
+    rb_native_mutex_lock(&copy->lock);
+    while (1) {
+        uint32_t num_rows, col;
+        int rv;
+
+        while (copy->num_rows[idx] == 0 && !copy->producer_done && !copy->cancelled) {
+            rb_native_cond_wait(&copy->cond, &copy->lock);
+        }
+        num_rows = copy->num_rows[idx];
+        if (copy->cancelled || num_rows == 0) {
+            break;
+        }
+        rb_native_mutex_unlock(&copy->lock);
+        for (col = 0; col < copy->num_cols; col++) {
+            if (dpiStmt_bindByPos(copy->dst_stmt, col + 1, copy->dst_vars[idx][col]) != DPI_SUCCESS) {
+                set_error(copy, copy->dst_dconn, 1);
+                return NULL;
+            }
+        }
+        if (!enter_call(copy, copy->dst_dconn, &copy->dst_in_call)) {
+            return NULL;
+        }
+        rv = dpiStmt_executeMany(copy->dst_stmt, DPI_MODE_EXEC_DEFAULT, num_rows);
+        leave_call(copy, copy->dst_dconn, &copy->dst_in_call);
+        if (rv != DPI_SUCCESS) {
+            set_error(copy, copy->dst_dconn, 1);
+            return NULL;
+        }
+        rb_native_mutex_lock(&copy->lock);
+        copy->row_count += num_rows;
+        copy->num_rows[idx] = 0;
+        rb_native_cond_broadcast(&copy->cond);
+        idx ^= 1;
+    }
+    rb_native_mutex_unlock(&copy->lock);
+    return NULL;
+}
+
+static VALUE consumer_thread(void *arg)
+{
+    rb_thread_call_without_gvl(consume, arg, copy_ubf, arg);
+    return Qnil;
+}
+
+static dpiVar *new_var(copy_t *copy, rbOraDBConn *dconn, dpiOracleTypeNum oracle_type, dpiNativeTypeNum native_type, uint32_t size)
+{
+    dpiVar *var;
+    dpiData *data;
+
+    if (dpiConn_newVar(dconn->handle, oracle_type, native_type, copy->batch_rows, size, 1, 0, NULL, &var, &data) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+    return var;
+}
+
+static VALUE copy_run(VALUE arg)
+{
+    copy_t *copy = (copy_t *)arg;
+    uint32_t col;
+
+    if (rbOraDBStmt_execute(copy->src_dconn, copy->src_stmt, DPI_MODE_EXEC_DEFAULT, &copy->num_cols) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(copy->src_dconn);
+    }
+    if (copy->num_cols == 0) {
+        rb_raise(rb_eArgError, "the source statement is not a query");
+    }
+    if (dpiStmt_getFetchArraySize(copy->src_stmt, &copy->orig_fetch_array_size) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(copy->src_dconn);
+    }
+    if (dpiStmt_setFetchArraySize(copy->src_stmt, copy->batch_rows) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(copy->src_dconn);
+    }
+    copy->src_vars = ZALLOC_N(dpiVar *, copy->num_cols);
+    copy->dst_vars[0] = ZALLOC_N(dpiVar *, copy->num_cols);
+    copy->dst_vars[1] = ZALLOC_N(dpiVar *, copy->num_cols);
+    for (col = 0; col < copy->num_cols; col++) {
+        dpiQueryInfo info;
+        dpiOracleTypeNum oracle_type;
+        dpiNativeTypeNum native_type;
+        uint32_t size;
+
+        if (dpiStmt_getQueryInfo(copy->src_stmt, col + 1, &info) != DPI_SUCCESS) {
+            rboradb_raise_conn_error(copy->src_dconn);
+        }
+        oracle_type = info.typeInfo.oracleTypeNum;
+        native_type = info.typeInfo.defaultNativeTypeNum;
+        size = info.typeInfo.clientSizeInBytes;
+        switch (oracle_type) {
+        case DPI_ORACLE_TYPE_NUMBER:
+            // keep the precision
+            native_type = DPI_NATIVE_TYPE_BYTES;
+            break;
+        case DPI_ORACLE_TYPE_ROWID:
+            // rowid descriptors cannot be used on another connection.
+            oracle_type = DPI_ORACLE_TYPE_VARCHAR;
+            native_type = DPI_NATIVE_TYPE_BYTES;
+            size = 4000;
+            break;
+        case DPI_ORACLE_TYPE_CLOB:
+            // LOB locators cannot be used on another connection either.
+            oracle_type = DPI_ORACLE_TYPE_LONG_VARCHAR;
+            native_type = DPI_NATIVE_TYPE_BYTES;
+            size = 0;
+            break;
+        case DPI_ORACLE_TYPE_BLOB:
+            oracle_type = DPI_ORACLE_TYPE_LONG_RAW;
+            native_type = DPI_NATIVE_TYPE_BYTES;
+            size = 0;
+            break;
+        case DPI_ORACLE_TYPE_NCLOB:
+            // LONG goes through the database character set, which may
+            // not cover national character data.
+        case DPI_ORACLE_TYPE_BFILE:
+        case DPI_ORACLE_TYPE_OBJECT:
+        case DPI_ORACLE_TYPE_STMT:
+        case DPI_ORACLE_TYPE_JSON:
+            rb_raise(rb_eArgError, "unsupported column type at position %u", col + 1);
+        default:
+            break;
+        }
+        copy->src_vars[col] = new_var(copy, copy->src_dconn, oracle_type, native_type, size);
+        copy->dst_vars[0][col] = new_var(copy, copy->dst_dconn, oracle_type, native_type, size);
+        copy->dst_vars[1][col] = new_var(copy, copy->dst_dconn, oracle_type, native_type, size);
+        if (dpiStmt_define(copy->src_stmt, col + 1, copy->src_vars[col]) != DPI_SUCCESS) {
+            rboradb_raise_conn_error(copy->src_dconn);
+        }
+    }
+
+    copy->consumer = rb_thread_create(consumer_thread, copy);
+    rb_thread_call_without_gvl(produce, copy, copy_ubf, copy);
+    rb_thread_check_ints();
+    copy->completed = 1;
+    return Qnil;
+}
+
+static VALUE copy_cleanup(VALUE arg)
+{
+    copy_t *copy = (copy_t *)arg;
+    uint32_t col;
+
+    if (!NIL_P(copy->consumer)) {
+        static ID id_join;
+        CONST_ID(id_join, "join");
+        if (!copy->completed) {
+            copy_ubf(copy);
+        }
+        rb_funcall(copy->consumer, id_join, 0);
+    }
+    for (col = 0; col < copy->num_cols; col++) {
+        if (copy->src_vars && copy->src_vars[col]) {
+            dpiVar_release(copy->src_vars[col]);
+        }
+        if (copy->dst_vars[0] && copy->dst_vars[0][col]) {
+            dpiVar_release(copy->dst_vars[0][col]);
+        }
+        if (copy->dst_vars[1] && copy->dst_vars[1][col]) {
+            dpiVar_release(copy->dst_vars[1][col]);
+        }
+    }
+    if (copy->orig_fetch_array_size != 0) {
+        // Variables defined later by the Stmt have its array size.
+        dpiStmt_setFetchArraySize(copy->src_stmt, copy->orig_fetch_array_size);
+    }
+    rb_native_cond_destroy(&copy->cond);
+    rb_native_mutex_destroy(&copy->lock);
+    xfree(copy->src_vars);
+    xfree(copy->dst_vars[0]);
+    xfree(copy->dst_vars[1]);
+    if (copy->dst_stmt) {
+        dpiStmt_release(copy->dst_stmt);
+    }
+    return Qnil;
+}
+
+static VALUE copy___copy(VALUE self, VALUE src_stmt, VALUE dst_conn, VALUE insert_sql, VALUE batch_rows)
+{
+    copy_t copy = {NULL,};
+
+    copy.src_stmt = rboradb_to_dpiStmt(src_stmt);
+    copy.src_dconn = rboradb_get_dconn_in_stmt(src_stmt);
+    copy.dst_dconn = rboradb_get_dconn_in_conn(dst_conn);
+    if (copy.dst_dconn == NULL) {
+        rb_raise(rb_eTypeError, "wrong argument type %s (expected OracleDB::Conn)", rb_obj_classname(dst_conn));
+    }
+    copy.batch_rows = NUM2UINT(batch_rows);
+    copy.consumer = Qnil;
+    if (copy.batch_rows == 0) {
+        rb_raise(rb_eArgError, "batch_rows must be positive");
+    }
+    ExportString(insert_sql);
+    if (dpiConn_prepareStmt(copy.dst_dconn->handle, 0, RSTRING_PTR(insert_sql), RSTRING_LEN(insert_sql), NULL, 0, &copy.dst_stmt) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(copy.dst_dconn);
+    }
+    rb_native_mutex_initialize(&copy.lock);
+    rb_native_cond_initialize(&copy.cond);
+    rb_ensure(copy_run, (VALUE)&copy, copy_cleanup, (VALUE)&copy);
+    if (copy.error.has_error) {
+        rboradb_raise_conn_error_info(copy.error.dconn, &copy.error.info);
+    }
+    RB_GC_GUARD(insert_sql);
+    return ULL2NUM(copy.row_count);
+}
+
+void rboradb_copy_init(VALUE mOracleDB)
+{
+    rb_define_private_method(rb_singleton_class(mOracleDB), "__copy", copy___copy, 4);
+}
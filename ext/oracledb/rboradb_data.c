@@ -16,11 +16,117 @@
 
 static VALUE sym_to_i;
 static VALUE sym_to_f;
+static VALUE sym_symbolize_names;
+static VALUE sym_to_json;
+static VALUE sym_lazy;
+static VALUE sym_to_struct;
 
 void rboradb_data_init(void)
 {
     sym_to_i = ID2SYM(rb_intern("to_i"));
     sym_to_f = ID2SYM(rb_intern("to_f"));
+    sym_symbolize_names = ID2SYM(rb_intern("symbolize_names"));
+    sym_to_json = ID2SYM(rb_intern("to_json"));
+    sym_lazy = ID2SYM(rb_intern("lazy"));
+    sym_to_struct = ID2SYM(rb_intern("to_struct"));
+}
+
+// Returns the coderange of UTF-8 bytes. ASCII runs are skipped eight
+// bytes at a time.
+static int utf8_coderange(const unsigned char *p, const unsigned char *e)
+{
+    int cr = RUBY_ENC_CODERANGE_7BIT;
+
+    while (p < e) {
+        unsigned char c = *p, lo = 0x80, hi = 0xBF;
+        int i, n;
+
+        if (e - p >= 8) {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if ((v & UINT64_C(0x8080808080808080)) == 0) {
+                p += 8;
+                continue;
+            }
+        }
+        if (c < 0x80) {
+            p++;
+            continue;
+        }
+        if (c < 0xC2) {
+            return RUBY_ENC_CODERANGE_BROKEN;
+        } else if (c <= 0xDF) {
+            n = 1;
+        } else if (c <= 0xEF) {
+            n = 2;
+            if (c == 0xE0) {
+                lo = 0xA0;
+            } else if (c == 0xED) {
+                hi = 0x9F; // surrogates
+            }
+        } else if (c <= 0xF4) {
+            n = 3;
+            if (c == 0xF0) {
+                lo = 0x90;
+            } else if (c == 0xF4) {
+                hi = 0x8F;
+            }
+        } else {
+            return RUBY_ENC_CODERANGE_BROKEN;
+        }
+        if (e - p <= n || p[1] < lo || p[1] > hi) {
+            return RUBY_ENC_CODERANGE_BROKEN;
+        }
+        for (i = 2; i <= n; i++) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return RUBY_ENC_CODERANGE_BROKEN;
+            }
+        }
+        p += n + 1;
+        cr = RUBY_ENC_CODERANGE_VALID;
+    }
+    return cr;
+}
+
+// Creates a string from fetched bytes. UTF-8 strings are scanned here
+// while the bytes are hot in the cache and get their coderange set, so
+// that ruby doesn't scan them again.
+VALUE rboradb_enc_str_new(const char *ptr, long len, rb_encoding *enc)
+{
+    VALUE str = rb_enc_str_new(ptr, len, enc);
+
+    if (enc == rb_utf8_encoding()) {
+        RB_ENC_CODERANGE_SET(str, utf8_coderange((const unsigned char *)ptr, (const unsigned char *)ptr + len));
+    }
+    return str;
+}
+
+// Returns +str+ converted to UTF-8, the client character set. Strings in
+// UTF-8 or US-ASCII and strings known to be ASCII only are returned as is
+// without calling rb_str_export_to_enc().
+VALUE rboradb_export_utf8(VALUE str)
+{
+    int encidx = RB_ENCODING_GET_INLINED(str);
+
+    if (encidx == rb_utf8_encindex() || encidx == rb_usascii_encindex()
+            || RB_ENC_CODERANGE(str) == RUBY_ENC_CODERANGE_7BIT) {
+        return str;
+    }
+    return rb_str_export_to_enc(str, rb_utf8_encoding());
+}
+
+rb_encoding *rboradb_bytes_encoding(dpiOracleTypeNum oracle_type_num)
+{
+    switch (oracle_type_num) {
+    case DPI_ORACLE_TYPE_VARCHAR:
+    case DPI_ORACLE_TYPE_CHAR:
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+    case DPI_ORACLE_TYPE_NVARCHAR:
+    case DPI_ORACLE_TYPE_NCHAR:
+        return rb_utf8_encoding();
+    default:
+        return rb_ascii8bit_encoding();
+    }
 }
 
 VALUE rboradb_from_data(const dpiData *data, dpiNativeTypeNum native_type_num, dpiOracleTypeNum oracle_type_num, dpiObjectType *objtype, VALUE filter, rbOraDBConn *dconn)
@@ -32,13 +138,15 @@ VALUE rboradb_from_data(const dpiData *data, dpiNativeTypeNum native_type_num, d
     }
     obj = rboradb_from_data_buffer(&data->value, native_type_num, oracle_type_num, objtype, &filter, dconn);
     if (!NIL_P(filter)) {
-        obj = rb_proc_call_with_block(filter, 1, &obj, Qnil);
+        obj = rboradb_apply_filter(filter, obj, 0);
     }
     return obj;
 }
 
 VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum native_type_num, dpiOracleTypeNum oracle_type_num, dpiObjectType *objtype, VALUE *filter, rbOraDBConn *dconn)
 {
+    rb_encoding *enc;
+
     switch (native_type_num) {
     case DPI_NATIVE_TYPE_INT64:
         return LL2NUM(value->asInt64);
@@ -49,7 +157,15 @@ VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum nati
     case DPI_NATIVE_TYPE_DOUBLE:
         return DBL2NUM(value->asDouble);
     case DPI_NATIVE_TYPE_BYTES:
-        if (*filter == sym_to_i || *filter == sym_to_f || oracle_type_num == DPI_ORACLE_TYPE_NVARCHAR) {
+        enc = rboradb_bytes_encoding(oracle_type_num);
+        if (RB_SYMBOL_P(*filter)) {
+            VALUE obj = rboradb_filter_bytes(*filter, value->asBytes.ptr, value->asBytes.length, enc);
+            if (obj != Qundef) {
+                *filter = Qnil;
+                return obj;
+            }
+        }
+        if (*filter == sym_to_i || *filter == sym_to_f) {
             VALUE tmp, obj;
             char *buf = RB_ALLOCV_N(char, tmp, value->asBytes.length + 1);
 
@@ -57,29 +173,22 @@ VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum nati
             buf[value->asBytes.length] = '\0';
             if (*filter == sym_to_i) {
                 obj = rb_cstr2inum(buf, 10);
-                *filter = Qnil;
-            } else if (*filter == sym_to_f) {
-                obj = DBL2NUM(rb_cstr_to_dbl(buf, 0));
-                *filter = Qnil;
-            } else if (strchr(buf, '.') == NULL) {
-                obj = rb_cstr2inum(buf, 10);
             } else {
                 obj = DBL2NUM(rb_cstr_to_dbl(buf, 0));
             }
+            *filter = Qnil;
             RB_ALLOCV_END(tmp);
             return obj;
         }
-        switch (oracle_type_num) {
-        case DPI_ORACLE_TYPE_VARCHAR:
-        case DPI_ORACLE_TYPE_CHAR:
-            return rb_enc_str_new(value->asBytes.ptr, value->asBytes.length, rb_utf8_encoding());
-        case DPI_ORACLE_TYPE_NVARCHAR:
-        case DPI_ORACLE_TYPE_NCHAR:
-            return rb_enc_str_new(value->asBytes.ptr, value->asBytes.length, rb_utf8_encoding());
-        default:
-            return rb_str_new(value->asBytes.ptr, value->asBytes.length);
-        }
+        return rboradb_enc_str_new(value->asBytes.ptr, value->asBytes.length, enc);
     case DPI_NATIVE_TYPE_TIMESTAMP:
+        if (RB_SYMBOL_P(*filter)) {
+            VALUE obj = rboradb_filter_timestamp(*filter, &value->asTimestamp, oracle_type_num, dconn);
+            if (obj != Qundef) {
+                *filter = Qnil;
+                return obj;
+            }
+        }
         return rboradb_from_dpiTimestamp(&value->asTimestamp);
     case DPI_NATIVE_TYPE_INTERVAL_DS:
         return rboradb_from_dpiIntervalDS(&value->asIntervalDS);
@@ -88,6 +197,10 @@ VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum nati
     case DPI_NATIVE_TYPE_LOB:
         return rboradb_from_dpiLob(value->asLOB, dconn, 1);
     case DPI_NATIVE_TYPE_OBJECT:
+        if (*filter == sym_to_struct) {
+            *filter = Qnil;
+            return rboradb_dpiObject_to_struct(value->asObject, objtype, dconn);
+        }
         return rboradb_from_dpiObject(value->asObject, objtype, dconn, 1);
     case DPI_NATIVE_TYPE_STMT:
         return rboradb_from_dpiStmt(value->asStmt, dconn, 1, 0);
@@ -96,7 +209,23 @@ VALUE rboradb_from_data_buffer(const dpiDataBuffer *value, dpiNativeTypeNum nati
     case DPI_NATIVE_TYPE_ROWID:
         return rboradb_from_dpiRowid(value->asRowid, dconn, 1);
     case DPI_NATIVE_TYPE_JSON:
-        return rboradb_dpiJson2ruby(value->asJson, dconn);
+        if (*filter == sym_symbolize_names) {
+            *filter = Qnil;
+            return rboradb_dpiJson2ruby(value->asJson, dconn, RBORADB_JSON_SYMBOLIZE_NAMES);
+        }
+        if (*filter == sym_to_json) {
+            *filter = Qnil;
+            return rboradb_dpiJson2ruby(value->asJson, dconn, RBORADB_JSON_TEXT);
+        }
+        if (*filter == sym_lazy) {
+            *filter = Qnil;
+            return rboradb_from_dpiJson(value->asJson, dconn);
+        }
+        return rboradb_dpiJson2ruby(value->asJson, dconn, 0);
+#ifdef RBORADB_HAVE_VECTOR
+    case DPI_NATIVE_TYPE_VECTOR:
+        return rboradb_from_dpiVector(value->asVector, dconn);
+#endif
     }
     rb_raise(rb_eRuntimeError, "unsupported native type %u", native_type_num);
 }
@@ -124,15 +253,16 @@ VALUE rboradb_set_data(VALUE obj, dpiData *data, dpiNativeTypeNum native_type_nu
         data->isNull = 0;
         break;
     case DPI_NATIVE_TYPE_BYTES:
+        if (oracle_type_num == DPI_ORACLE_TYPE_NUMBER && !RB_TYPE_P(obj, T_STRING)) {
+            obj = rboradb_number_to_text(obj);
+        }
         StringValue(obj);
         switch (oracle_type_num) {
         case DPI_ORACLE_TYPE_VARCHAR:
         case DPI_ORACLE_TYPE_CHAR:
-            obj = rb_str_export_to_enc(obj, rb_utf8_encoding());
-            break;
         case DPI_ORACLE_TYPE_NVARCHAR:
         case DPI_ORACLE_TYPE_NCHAR:
-            obj = rb_str_export_to_enc(obj, rb_utf8_encoding());
+            obj = rboradb_export_utf8(obj);
             break;
         case DPI_ORACLE_TYPE_NUMBER:
             obj = rb_str_export_to_enc(obj, rb_usascii_encoding());
@@ -199,6 +329,17 @@ VALUE rboradb_set_data(VALUE obj, dpiData *data, dpiNativeTypeNum native_type_nu
         rboradb_ruby2dpiJson(obj, data->value.asJson, dconn);
         data->isNull = 0;
         break;
+#ifdef RBORADB_HAVE_VECTOR
+    case DPI_NATIVE_TYPE_VECTOR:
+        if (var) {
+            dpiVector *vec = rboradb_to_dpiVector(obj, dconn);
+            err = dpiVar_setFromVector(var, pos, vec);
+            dpiVector_release(vec);
+        } else {
+            rb_raise(rb_eNotImpError, "VECTOR values are supported only in variables");
+        }
+        break;
+#endif
     default:
         rb_raise(rb_eRuntimeError, "unsupported native type %u", native_type_num);
     }
@@ -13,6 +13,7 @@
 // (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
 //-----------------------------------------------------------------------------
 #include <rboradb.h>
+#include <time.h>
 
 #define To_Timestamp(obj) ((dpiTimestamp *)rb_check_typeddata((obj), &timestamp_data_type))
 #define To_IntervalDS(obj) ((dpiIntervalDS *)rb_check_typeddata((obj), &interval_ds_data_type))
@@ -22,22 +23,150 @@ static VALUE cTimestamp;
 static VALUE cIntervalDS;
 static VALUE cIntervalYM;
 
+static ID id_utc_offset;
+
+// Returns days since 1970-01-01 in the proleptic Gregorian calendar.
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    int64_t era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int64_t z, int *y, unsigned *m, unsigned *d)
+{
+    int64_t era, doe, yoe, doy, mp;
+
+    z += 719468;
+    era = (z >= 0 ? z : z - 146096) / 146097;
+    doe = z - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    *d = (unsigned)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (unsigned)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+static int64_t utc_secs(const dpiTimestamp *val)
+{
+    return days_from_civil(val->year, val->month, val->day) * 86400
+        + val->hour * 3600 + val->minute * 60 + val->second;
+}
+
+static int32_t local_offset_by_mktime(const dpiTimestamp *val)
+{
+    struct tm tm = {0};
+
+    tm.tm_year = val->year - 1900;
+    tm.tm_mon = val->month - 1;
+    tm.tm_mday = val->day;
+    tm.tm_hour = val->hour;
+    tm.tm_min = val->minute;
+    tm.tm_sec = val->second;
+    tm.tm_isdst = -1;
+    return (int32_t)(utc_secs(val) - (int64_t)mktime(&tm));
+}
+
+// Flushes cached offsets when the TZ environment variable differs from
+// the one in effect when they were cached. It returns false when TZ is
+// too long to be kept.
+static int tz_cache_check(rbOraDBTzCache *cache)
+{
+    const char *tz = getenv("TZ");
+    size_t len = tz ? strlen(tz) : 0;
+
+    if (len >= RBORADB_TZ_MAX_LEN) {
+        return 0;
+    }
+    if (cache->tz_isset != (tz != NULL) || (tz != NULL && strcmp(cache->tz, tz) != 0)) {
+        memset(cache->hours, 0, sizeof(cache->hours));
+        cache->tz_isset = tz != NULL;
+        memcpy(cache->tz, tz ? tz : "", len + 1);
+    }
+    return 1;
+}
+
+// Returns the UTC offset of local time. As mktime() is slow, offsets
+// are cached per connection by hours, the unit of daylight saving time
+// transitions.
+static int32_t local_offset(const dpiTimestamp *val, rbOraDBConn *dconn)
+{
+    rbOraDBTzCache *cache;
+    int64_t hours;
+    int idx;
+    dpiTimestamp hour_val;
+
+    if (dconn == NULL) {
+        return local_offset_by_mktime(val);
+    }
+    if (dconn->tz_cache == NULL) {
+        dconn->tz_cache = ZALLOC(rbOraDBTzCache);
+    }
+    cache = dconn->tz_cache;
+    if (!tz_cache_check(cache)) {
+        return local_offset_by_mktime(val);
+    }
+    hours = days_from_civil(val->year, val->month, val->day) * 24 + val->hour;
+    idx = (int)(hours & (RBORADB_TZ_CACHE_SIZE - 1));
+    if (cache->hours[idx] != hours + 1) {
+        hour_val = *val;
+        hour_val.minute = 0;
+        hour_val.second = 0;
+        cache->offsets[idx] = local_offset_by_mktime(&hour_val);
+        cache->hours[idx] = hours + 1;
+    }
+    return cache->offsets[idx];
+}
+
+static int32_t utc_offset(const dpiTimestamp *val, int tz, rbOraDBConn *dconn)
+{
+    switch (tz) {
+    case RBORADB_TZ_UTC:
+        return 0;
+    case RBORADB_TZ_OFFSET:
+        return val->tzHourOffset * 3600 + val->tzMinuteOffset * 60;
+    default:
+        return local_offset(val, dconn);
+    }
+}
+
+static size_t timestamp_memsize(const void *arg)
+{
+    return sizeof(dpiTimestamp);
+}
+
 static const struct rb_data_type_struct timestamp_data_type = {
     "OracleDB::Timestamp",
-    {NULL, NULL,},
-    NULL, NULL,
+    {NULL, RUBY_TYPED_DEFAULT_FREE, timestamp_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
+static size_t interval_ds_memsize(const void *arg)
+{
+    return sizeof(dpiIntervalDS);
+}
+
 static const struct rb_data_type_struct interval_ds_data_type = {
     "OracleDB::IntervalDS",
-    {NULL, NULL,},
-    NULL, NULL,
+    {NULL, RUBY_TYPED_DEFAULT_FREE, interval_ds_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
+static size_t interval_ym_memsize(const void *arg)
+{
+    return sizeof(dpiIntervalYM);
+}
+
 static const struct rb_data_type_struct interval_ym_data_type = {
     "OracleDB::IntervalYM",
-    {NULL, NULL,},
-    NULL, NULL,
+    {NULL, RUBY_TYPED_DEFAULT_FREE, interval_ym_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE timestamp_alloc(VALUE klass)
@@ -261,6 +390,8 @@ static VALUE interval_ym_months(VALUE self)
 
 void rboradb_datetime_init(VALUE mOracleDB)
 {
+    id_utc_offset = rb_intern("utc_offset");
+
     cTimestamp = rb_define_class_under(mOracleDB, "Timestamp", rb_cObject);
     rb_define_alloc_func(cTimestamp, timestamp_alloc);
     rb_define_method(cTimestamp, "initialize", timestamp_initialize, -1);
@@ -304,6 +435,50 @@ VALUE rboradb_from_dpiTimestamp(const dpiTimestamp *val)
     return obj;
 }
 
+// Converts +val+ to Time. The returned Time is in UTC when +utc+ is true.
+VALUE rboradb_timestamp_to_time(const dpiTimestamp *val, int tz, int utc, rbOraDBConn *dconn)
+{
+    struct timespec ts;
+    int32_t offset = utc_offset(val, tz, dconn);
+
+    ts.tv_sec = (time_t)(utc_secs(val) - offset);
+    ts.tv_nsec = val->fsecond;
+    if (utc) {
+        return rb_time_timespec_new(&ts, INT_MAX - 1);
+    }
+    return rb_time_timespec_new(&ts, tz == RBORADB_TZ_OFFSET ? offset : INT_MAX);
+}
+
+// Returns seconds since the epoch.
+int64_t rboradb_timestamp_to_epoch(const dpiTimestamp *val, int tz, rbOraDBConn *dconn)
+{
+    return utc_secs(val) - utc_offset(val, tz, dconn);
+}
+
+VALUE rboradb_time_to_timestamp(VALUE time)
+{
+    struct timespec ts = rb_time_timespec(time);
+    int offset = NUM2INT(rb_funcall(time, id_utc_offset, 0));
+    int64_t secs = (int64_t)ts.tv_sec + offset;
+    int64_t days = (secs >= 0 ? secs : secs - 86399) / 86400;
+    int64_t rest = secs - days * 86400;
+    dpiTimestamp val;
+    int year;
+    unsigned month, day;
+
+    civil_from_days(days, &year, &month, &day);
+    val.year = year;
+    val.month = month;
+    val.day = day;
+    val.hour = (uint8_t)(rest / 3600);
+    val.minute = (uint8_t)(rest / 60 % 60);
+    val.second = (uint8_t)(rest % 60);
+    val.fsecond = (uint32_t)ts.tv_nsec;
+    val.tzHourOffset = offset / 3600;
+    val.tzMinuteOffset = offset / 60 % 60;
+    return rboradb_from_dpiTimestamp(&val);
+}
+
 VALUE rboradb_from_dpiIntervalDS(const dpiIntervalDS *val)
 {
     dpiIntervalDS *v;
@@ -0,0 +1,424 @@
+// ruby-oracledb - Ruby binding for Oracle database based on ODPI-C
+//
+// URL: https://github.com/kubo/ruby-oracledb
+//
+//-----------------------------------------------------------------------------
+// Copyright (c) 2021 Kubo Takehiro <kubo@jiubao.org>. All rights reserved.
+// This program is free software: you can modify it and/or redistribute it
+// under the terms of:
+//
+// (i)  the Universal Permissive License v 1.0 or at your option, any
+//      later version (http://oss.oracle.com/licenses/upl); and/or
+//
+// (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
+//-----------------------------------------------------------------------------
+#include "rboradb.h"
+#include "ruby/thread.h"
+#include "ruby/thread_native.h"
+#ifndef WIN32
+#include <time.h>
+#include <pthread.h>
+#endif
+
+// Connections with deadlines are kept in a binary min-heap ordered by
+// rbOraDBConn.deadline_at. Expired ones stay in the heap after pending
+// ones until their deadlines are popped. One ruby thread, which runs
+// without GVL almost all the time, waits for the earliest deadline and
+// calls dpiConn_breakExecution() when it passes during a breakable call.
+// A connection is never broken while it is idle because the break would
+// be left pending and fail an unrelated call later. Breakable calls
+// started after the deadline aren't run at all. In both cases
+// RBORADB_RAISE_ERROR() raises OracleDB::TimeoutError in place of
+// OracleDB::Error.
+//
+// The heap lock is taken to change the heap. Breakable calls take only
+// rbOraDBConn.deadline_lock of their connection, and only when the
+// connection has a deadline.
+
+static VALUE thread = Qnil;
+static rb_nativethread_lock_t lock;
+static rb_nativethread_cond_t cond;
+static rbOraDBConn **heap;
+static long heap_size;
+static long heap_capa;
+static int interrupted;
+#ifndef WIN32
+// connections left in the heap of the parent process
+static rbOraDBConn **orphans;
+static long num_orphans;
+#endif
+
+static uint64_t current_msec(void)
+{
+#ifdef WIN32
+    return GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+static uint64_t heap_key(const rbOraDBConn *dconn)
+{
+    return dconn->deadline_expired ? UINT64_MAX : dconn->deadline_at;
+}
+
+static void heap_set(long idx, rbOraDBConn *dconn)
+{
+    heap[idx] = dconn;
+    dconn->deadline_idx = idx;
+}
+
+static void heap_sift_up(long idx)
+{
+    rbOraDBConn *dconn = heap[idx];
+
+    while (idx > 0) {
+        long parent = (idx - 1) / 2;
+        if (heap_key(heap[parent]) <= heap_key(dconn)) {
+            break;
+        }
+        heap_set(idx, heap[parent]);
+        idx = parent;
+    }
+    heap_set(idx, dconn);
+}
+
+static void heap_sift_down(long idx)
+{
+    rbOraDBConn *dconn = heap[idx];
+
+    while (1) {
+        long child = idx * 2 + 1;
+        if (child >= heap_size) {
+            break;
+        }
+        if (child + 1 < heap_size && heap_key(heap[child + 1]) < heap_key(heap[child])) {
+            child++;
+        }
+        if (heap_key(dconn) <= heap_key(heap[child])) {
+            break;
+        }
+        heap_set(idx, heap[child]);
+        idx = child;
+    }
+    heap_set(idx, dconn);
+}
+
+// This must be called with GVL and without the lock because memory allocation
+// may raise an exception.
+static void heap_reserve(void)
+{
+    rbOraDBConn **new_heap, **old_heap;
+    long new_capa;
+
+    if (heap_size < heap_capa) {
+        return;
+    }
+    new_capa = heap_capa ? heap_capa * 2 : 16;
+    new_heap = ALLOC_N(rbOraDBConn *, new_capa);
+    rb_native_mutex_lock(&lock);
+    MEMCPY(new_heap, heap, rbOraDBConn *, heap_size);
+    old_heap = heap;
+    heap = new_heap;
+    heap_capa = new_capa;
+    rb_native_mutex_unlock(&lock);
+    xfree(old_heap);
+}
+
+static void heap_push(rbOraDBConn *dconn)
+{
+    heap_set(heap_size++, dconn);
+    heap_sift_up(dconn->deadline_idx);
+}
+
+static void heap_remove(rbOraDBConn *dconn)
+{
+    long idx = dconn->deadline_idx;
+    rbOraDBConn *moved;
+
+    dconn->deadline_idx = -1;
+    if (--heap_size == idx) {
+        return;
+    }
+    moved = heap[heap_size];
+    heap_set(idx, moved);
+    heap_sift_up(idx);
+    heap_sift_down(moved->deadline_idx);
+}
+
+static void set_expired(rbOraDBConn *dconn, int expired)
+{
+    rb_native_mutex_lock(&dconn->deadline_lock);
+    dconn->deadline_expired = expired;
+    rb_native_mutex_unlock(&dconn->deadline_lock);
+}
+
+static void *release_conn(void *arg)
+{
+    rbOraDBConn_release((rbOraDBConn *)arg);
+    return NULL;
+}
+
+static void *timer_loop(void *arg)
+{
+    rb_native_mutex_lock(&lock);
+    while (!interrupted) {
+        uint64_t now = current_msec();
+        rbOraDBConn *dconn;
+
+        if (heap_size == 0 || heap[0]->deadline_expired) {
+            rb_native_cond_wait(&cond, &lock);
+            continue;
+        }
+        dconn = heap[0];
+        if (dconn->deadline_at > now) {
+            rb_native_cond_timedwait(&cond, &lock, (unsigned long)(dconn->deadline_at - now));
+            continue;
+        }
+        rb_native_mutex_lock(&dconn->deadline_lock);
+        dconn->deadline_expired = 1;
+        heap_sift_down(0);
+        if (!dconn->deadline_in_call) {
+            rb_native_mutex_unlock(&dconn->deadline_lock);
+            continue;
+        }
+        dconn->deadline_broken = RBORADB_DEADLINE_BROKEN;
+        // The break may take a network round trip. It is done without
+        // the heap lock not to block other connections. deadline_lock
+        // is kept so that the call doesn't return meanwhile and leave
+        // the break pending. The reference keeps the connection.
+        rbOraDBConn_addRef(dconn);
+        rb_native_mutex_unlock(&lock);
+        dpiConn_breakExecution(dconn->handle);
+        rb_native_mutex_unlock(&dconn->deadline_lock);
+        rb_thread_call_with_gvl(release_conn, dconn);
+        rb_native_mutex_lock(&lock);
+    }
+    interrupted = 0;
+    rb_native_mutex_unlock(&lock);
+    return NULL;
+}
+
+static void timer_ubf(void *arg)
+{
+    rb_native_mutex_lock(&lock);
+    interrupted = 1;
+    rb_native_cond_signal(&cond);
+    rb_native_mutex_unlock(&lock);
+}
+
+static VALUE timer_thread(void *arg)
+{
+    while (1) {
+        rb_thread_call_without_gvl(timer_loop, NULL, timer_ubf, NULL);
+        rb_thread_check_ints();
+    }
+    return Qnil;
+}
+
+#ifndef WIN32
+// Called in the child process just after fork. The timer thread and
+// deadlines of the parent don't exist in the child. Connections in the
+// heap are detached from it and released later with GVL.
+static void after_fork_child(void)
+{
+    long idx;
+
+    rb_native_mutex_initialize(&lock);
+    rb_native_cond_initialize(&cond);
+    for (idx = 0; idx < heap_size; idx++) {
+        rbOraDBConn *dconn = heap[idx];
+
+        rb_native_mutex_initialize(&dconn->deadline_lock);
+        dconn->deadline_idx = -1;
+        dconn->deadline_set = 0;
+        dconn->deadline_expired = 0;
+        dconn->deadline_in_call = 0;
+        dconn->deadline_broken = 0;
+    }
+    orphans = heap;
+    num_orphans = heap_size;
+    heap = NULL;
+    heap_size = 0;
+    heap_capa = 0;
+    interrupted = 0;
+    thread = Qnil;
+}
+
+static void release_orphans(void)
+{
+    rbOraDBConn **conns = orphans;
+    long idx, num = num_orphans;
+
+    orphans = NULL;
+    num_orphans = 0;
+    for (idx = 0; idx < num; idx++) {
+        rbOraDBConn_release(conns[idx]);
+    }
+    xfree(conns);
+}
+#endif
+
+static void start_timer_thread(void)
+{
+#ifndef WIN32
+    if (orphans != NULL) {
+        release_orphans();
+    }
+#endif
+    if (!NIL_P(thread)) {
+        static ID id_alive_p;
+        CONST_ID(id_alive_p, "alive?");
+        if (RTEST(rb_funcall(thread, id_alive_p, 0))) {
+            return;
+        }
+    }
+    thread = rb_thread_create(timer_thread, NULL);
+}
+
+static void set_deadline(rbOraDBConn *dconn, uint64_t at)
+{
+    if (dconn->deadline_set) {
+        heap_remove(dconn);
+    } else {
+        rbOraDBConn_addRef(dconn);
+        dconn->deadline_set = 1;
+    }
+    dconn->deadline_at = at;
+    set_expired(dconn, 0);
+    heap_push(dconn);
+}
+
+static void clear_deadline(rbOraDBConn *dconn)
+{
+    heap_remove(dconn);
+    dconn->deadline_set = 0;
+    rb_native_mutex_lock(&dconn->deadline_lock);
+    dconn->deadline_expired = 0;
+    dconn->deadline_in_call = 0;
+    dconn->deadline_broken = 0;
+    rb_native_mutex_unlock(&dconn->deadline_lock);
+}
+
+VALUE rboradb_push_deadline(VALUE self, VALUE secs)
+{
+    rbOraDBConn *dconn = rboradb_get_dconn(self);
+    double fsecs = NUM2DBL(secs);
+    uint64_t at = current_msec() + (fsecs > 0 ? (uint64_t)(fsecs * 1000) : 0);
+    VALUE prev = Qnil;
+
+    start_timer_thread();
+    heap_reserve();
+    rb_native_mutex_lock(&lock);
+    if (dconn->deadline_set) {
+        prev = ULL2NUM(dconn->deadline_at);
+        if (dconn->deadline_expired || dconn->deadline_at <= at) {
+            // The outer deadline is earlier. Keep it.
+            rb_native_mutex_unlock(&lock);
+            return prev;
+        }
+    }
+    set_deadline(dconn, at);
+    rb_native_cond_signal(&cond);
+    rb_native_mutex_unlock(&lock);
+    return prev;
+}
+
+VALUE rboradb_pop_deadline(VALUE self, VALUE prev)
+{
+    rbOraDBConn *dconn = rboradb_get_dconn(self);
+    int release = 0;
+
+#ifndef WIN32
+    if (orphans != NULL) {
+        release_orphans();
+    }
+#endif
+    heap_reserve();
+    rb_native_mutex_lock(&lock);
+    if (NIL_P(prev)) {
+        if (dconn->deadline_set) {
+            clear_deadline(dconn);
+            release = 1;
+        }
+    } else if (dconn->deadline_set && dconn->deadline_at != NUM2ULL(prev)) {
+        uint64_t at = NUM2ULL(prev);
+
+        if (at > current_msec()) {
+            // restore the outer deadline
+            set_deadline(dconn, at);
+            rb_native_cond_signal(&cond);
+        } else {
+            dconn->deadline_at = at;
+            set_expired(dconn, 1);
+            heap_sift_down(dconn->deadline_idx);
+        }
+    }
+    rb_native_mutex_unlock(&lock);
+    if (release) {
+        rbOraDBConn_release(dconn);
+    }
+    return Qnil;
+}
+
+// Returns RBORADB_DEADLINE_BROKEN or RBORADB_DEADLINE_SKIPPED when the
+// last breakable call failed by the deadline, otherwise zero. The state
+// is cleared so that later errors aren't regarded as timeouts.
+int rboradb_deadline_expired(rbOraDBConn *dconn)
+{
+    int broken;
+
+    if (!dconn->deadline_set) {
+        return 0;
+    }
+    rb_native_mutex_lock(&dconn->deadline_lock);
+    broken = dconn->deadline_broken;
+    dconn->deadline_broken = 0;
+    rb_native_mutex_unlock(&dconn->deadline_lock);
+    return broken;
+}
+
+// This is called without GVL by the wrappers of breakable ODPI-C
+// functions just before calling them. It returns nonzero when the call
+// must not run because the deadline has passed.
+int rboradb_deadline_enter(rbOraDBConn *dconn)
+{
+    int skip = 0;
+
+    if (!dconn->deadline_set) {
+        return 0;
+    }
+    rb_native_mutex_lock(&dconn->deadline_lock);
+    if (dconn->deadline_expired) {
+        dconn->deadline_broken = RBORADB_DEADLINE_SKIPPED;
+        skip = 1;
+    } else {
+        dconn->deadline_broken = 0;
+        dconn->deadline_in_call = 1;
+    }
+    rb_native_mutex_unlock(&dconn->deadline_lock);
+    return skip;
+}
+
+// This is called without GVL just after a breakable ODPI-C call.
+void rboradb_deadline_leave(rbOraDBConn *dconn)
+{
+    if (!dconn->deadline_set) {
+        return;
+    }
+    rb_native_mutex_lock(&dconn->deadline_lock);
+    dconn->deadline_in_call = 0;
+    rb_native_mutex_unlock(&dconn->deadline_lock);
+}
+
+void rboradb_deadline_init(void)
+{
+    rb_native_mutex_initialize(&lock);
+    rb_native_cond_initialize(&cond);
+    rb_global_variable(&thread);
+#ifndef WIN32
+    pthread_atfork(NULL, NULL, after_fork_child);
+#endif
+}
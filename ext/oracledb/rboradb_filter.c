@@ -0,0 +1,355 @@
+// ruby-oracledb - Ruby binding for Oracle database based on ODPI-C
+//
+// URL: https://github.com/kubo/ruby-oracledb
+//
+//-----------------------------------------------------------------------------
+// Copyright (c) 2021 Kubo Takehiro <kubo@jiubao.org>. All rights reserved.
+// This program is free software: you can modify it and/or redistribute it
+// under the terms of:
+//
+// (i)  the Universal Permissive License v 1.0 or at your option, any
+//      later version (http://oss.oracle.com/licenses/upl); and/or
+//
+// (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
+//-----------------------------------------------------------------------------
+#include "rboradb.h"
+
+// out_filter and in_filter of variables are procs or symbols. Symbols
+// below are converters implemented in C. Other symbols are converted to
+// procs by Symbol#to_proc.
+
+static VALUE sym_to_sym;
+static VALUE sym_strip;
+static VALUE sym_to_time;
+static VALUE sym_to_utc_time;
+static VALUE sym_to_date;
+static VALUE sym_epoch_ms;
+static VALUE sym_epoch_ns;
+static VALUE sym_to_bigdecimal;
+static VALUE sym_bigdecimal;
+static VALUE sym_to_bool_yn;
+static VALUE sym_frozen;
+static VALUE sym_dedup;
+// symbols available only for specific native types
+static VALUE sym_to_i;
+static VALUE sym_to_f;
+static VALUE sym_column_dedup;
+static VALUE sym_symbolize_names;
+static VALUE sym_to_json;
+static VALUE sym_lazy;
+static VALUE sym_from_json;
+static VALUE sym_to_struct;
+
+static ID id_BigDecimal;
+static ID id_to_s;
+static ID id_divmod;
+static ID id_to_sym;
+static ID id_strip;
+static ID id_civil;
+static ID id_year;
+static ID id_mon;
+static ID id_mday;
+
+static VALUE cDate = Qnil;
+static VALUE cBigDecimal = Qnil;
+
+static int is_native_filter(VALUE filter)
+{
+    return filter == sym_to_sym || filter == sym_strip || filter == sym_to_time || filter == sym_to_utc_time
+        || filter == sym_to_date || filter == sym_epoch_ms || filter == sym_epoch_ns || filter == sym_to_bigdecimal
+        || filter == sym_to_bool_yn || filter == sym_frozen || filter == sym_dedup;
+}
+
+static VALUE date_class(void)
+{
+    if (NIL_P(cDate)) {
+        rb_require("date");
+        cDate = rb_const_get(rb_cObject, rb_intern("Date"));
+    }
+    return cDate;
+}
+
+static VALUE bigdecimal_class(void)
+{
+    if (NIL_P(cBigDecimal)) {
+        rb_require("bigdecimal");
+        cBigDecimal = rb_const_get(rb_cObject, id_BigDecimal);
+    }
+    return cBigDecimal;
+}
+
+static VALUE to_bigdecimal(VALUE str)
+{
+    bigdecimal_class();
+    return rb_funcall(rb_mKernel, id_BigDecimal, 1, str);
+}
+
+static VALUE bool_yn(const char *ptr, long len)
+{
+    if (len == 1) {
+        switch (*ptr) {
+        case 'Y': case 'y': case 'T': case 't': case '1':
+            return Qtrue;
+        case 'N': case 'n': case 'F': case 'f': case '0':
+            return Qfalse;
+        }
+    }
+    rb_raise(rb_eArgError, "invalid value for to_bool_yn: %.*s", (int)len, ptr);
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r' || c == '\0';
+}
+
+VALUE rboradb_to_filter(VALUE filter, dpiNativeTypeNum native_type_num, int in)
+{
+    const char *name = in ? "in_filter" : "out_filter";
+
+    if (NIL_P(filter) || rb_obj_is_proc(filter)) {
+        return filter;
+    }
+    if (RB_SYMBOL_P(filter)) {
+        static ID id;
+
+        if (is_native_filter(filter)) {
+            return filter;
+        }
+        if (filter == sym_bigdecimal) {
+            return sym_to_bigdecimal;
+        }
+        if (!in && native_type_num == DPI_NATIVE_TYPE_BYTES && (filter == sym_to_i || filter == sym_to_f || filter == sym_column_dedup)) {
+            return filter;
+        }
+        if (!in && native_type_num == DPI_NATIVE_TYPE_JSON && (filter == sym_symbolize_names || filter == sym_to_json || filter == sym_lazy)) {
+            return filter;
+        }
+        if (in && native_type_num == DPI_NATIVE_TYPE_JSON && filter == sym_from_json) {
+            return filter;
+        }
+        if (!in && native_type_num == DPI_NATIVE_TYPE_OBJECT && filter == sym_to_struct) {
+            return filter;
+        }
+        CONST_ID(id, "to_proc");
+        return rb_funcall(filter, id, 0);
+    }
+    rb_raise(rb_eArgError, "wrong %s type (given %s, expected nil, symbol, proc or lambda)", name, rb_obj_classname(filter));
+}
+
+// Applies +filter+ to fetched bytes without creating an intermediate string.
+// Returns Qundef when +filter+ doesn't work on bytes.
+VALUE rboradb_filter_bytes(VALUE filter, const char *ptr, uint32_t len, rb_encoding *enc)
+{
+    if (filter == sym_dedup) {
+        return rb_enc_interned_str(ptr, len, enc);
+    }
+    if (filter == sym_to_sym) {
+        // dynamic symbols, which are collected by GC unlike rb_intern3()
+        return rb_str_intern(rb_enc_interned_str(ptr, len, enc));
+    }
+    if (filter == sym_strip) {
+        while (len > 0 && is_space(*ptr)) {
+            ptr++;
+            len--;
+        }
+        while (len > 0 && is_space(ptr[len - 1])) {
+            len--;
+        }
+        return rboradb_enc_str_new(ptr, len, enc);
+    }
+    if (filter == sym_to_bool_yn) {
+        return bool_yn(ptr, len);
+    }
+    if (filter == sym_to_bigdecimal) {
+        return to_bigdecimal(rb_usascii_str_new(ptr, len));
+    }
+    return Qundef;
+}
+
+// Applies +filter+ to a fetched timestamp without creating
+// OracleDB::Timestamp. Returns Qundef when +filter+ doesn't work on
+// timestamps. Values without time zone are regarded as local time except
+// by :to_utc_time, which regards them as UTC.
+VALUE rboradb_filter_timestamp(VALUE filter, const dpiTimestamp *val, dpiOracleTypeNum oracle_type_num, rbOraDBConn *dconn)
+{
+    int has_tz = oracle_type_num == DPI_ORACLE_TYPE_TIMESTAMP_TZ || oracle_type_num == DPI_ORACLE_TYPE_TIMESTAMP_LTZ;
+    int tz = has_tz ? RBORADB_TZ_OFFSET : RBORADB_TZ_LOCAL;
+
+    if (filter == sym_to_time) {
+        return rboradb_timestamp_to_time(val, tz, 0, dconn);
+    }
+    if (filter == sym_to_utc_time) {
+        return rboradb_timestamp_to_time(val, has_tz ? RBORADB_TZ_OFFSET : RBORADB_TZ_UTC, 1, dconn);
+    }
+    if (filter == sym_to_date) {
+        return rb_funcall(date_class(), id_civil, 3, INT2FIX(val->year), INT2FIX(val->month), INT2FIX(val->day));
+    }
+    if (filter == sym_epoch_ms) {
+        return LL2NUM(rboradb_timestamp_to_epoch(val, tz, dconn) * 1000 + val->fsecond / 1000000);
+    }
+    if (filter == sym_epoch_ns) {
+        VALUE nsecs = rb_funcall(LL2NUM(rboradb_timestamp_to_epoch(val, tz, dconn)), '*', 1, INT2FIX(1000000000));
+        return rb_funcall(nsecs, '+', 1, UINT2NUM(val->fsecond));
+    }
+    return Qundef;
+}
+
+static VALUE out_filter(VALUE filter, VALUE obj)
+{
+    VALUE val;
+
+    if (filter == sym_frozen) {
+        return rb_obj_freeze(obj);
+    }
+    if (RB_TYPE_P(obj, T_STRING)) {
+        val = rboradb_filter_bytes(filter, RSTRING_PTR(obj), RSTRING_LEN(obj), rb_enc_get(obj));
+        if (val != Qundef) {
+            RB_GC_GUARD(obj);
+            return val;
+        }
+    } else if (rboradb_is_Timestamp(obj)) {
+        val = rboradb_filter_timestamp(filter, rboradb_to_dpiTimestamp(obj), DPI_ORACLE_TYPE_TIMESTAMP, NULL);
+        if (val != Qundef) {
+            return val;
+        }
+    } else if (filter == sym_to_bigdecimal && RB_INTEGER_TYPE_P(obj)) {
+        return to_bigdecimal(obj);
+    } else if (filter == sym_to_bigdecimal && RB_FLOAT_TYPE_P(obj)) {
+        return to_bigdecimal(rb_funcall(obj, id_to_s, 0));
+    } else if (filter == sym_to_sym) {
+        return rb_funcall(obj, id_to_sym, 0);
+    } else if (filter == sym_strip) {
+        return rb_funcall(obj, id_strip, 0);
+    } else if (filter == sym_dedup) {
+        return obj;
+    }
+    rb_raise(rb_eTypeError, "%"PRIsVALUE" filter isn't applicable to %s", filter, rb_obj_classname(obj));
+}
+
+static VALUE in_filter(VALUE filter, VALUE obj)
+{
+    if (filter == sym_frozen || filter == sym_dedup) {
+        return obj;
+    }
+    if (filter == sym_to_sym) {
+        return RB_SYMBOL_P(obj) ? rb_sym2str(obj) : obj;
+    }
+    if (filter == sym_strip) {
+        return RB_TYPE_P(obj, T_STRING) ? rb_funcall(obj, id_strip, 0) : obj;
+    }
+    if (filter == sym_to_bool_yn) {
+        if (obj == Qtrue) {
+            return rb_usascii_str_new_cstr("Y");
+        }
+        if (obj == Qfalse) {
+            return rb_usascii_str_new_cstr("N");
+        }
+        return obj;
+    }
+    if (filter == sym_to_bigdecimal) {
+        // BigDecimal#to_s returns a string in engineering notation.
+        return RB_TYPE_P(obj, T_STRING) ? obj : rb_funcall(obj, id_to_s, 1, rb_usascii_str_new_cstr("F"));
+    }
+    if (filter == sym_to_time || filter == sym_to_utc_time) {
+        return rb_obj_is_kind_of(obj, rb_cTime) ? rboradb_time_to_timestamp(obj) : obj;
+    }
+    if (filter == sym_to_date) {
+        if (rb_obj_is_kind_of(obj, date_class())) {
+            dpiTimestamp val = {0,};
+
+            val.year = NUM2INT(rb_funcall(obj, id_year, 0));
+            val.month = NUM2UINT(rb_funcall(obj, id_mon, 0));
+            val.day = NUM2UINT(rb_funcall(obj, id_mday, 0));
+            return rboradb_from_dpiTimestamp(&val);
+        }
+        return obj;
+    }
+    if (filter == sym_epoch_ms) {
+        if (RB_INTEGER_TYPE_P(obj)) {
+            int64_t msecs = NUM2LL(obj);
+            int64_t secs = (msecs >= 0 ? msecs : msecs - 999) / 1000;
+            struct timespec ts;
+
+            ts.tv_sec = (time_t)secs;
+            ts.tv_nsec = (long)(msecs - secs * 1000) * 1000000;
+            return rboradb_time_to_timestamp(rb_time_timespec_new(&ts, INT_MAX));
+        }
+        return obj;
+    }
+    if (filter == sym_epoch_ns) {
+        if (RB_INTEGER_TYPE_P(obj)) {
+            VALUE ary = rb_funcall(obj, id_divmod, 1, INT2FIX(1000000000));
+            struct timespec ts;
+
+            ts.tv_sec = (time_t)NUM2LL(RARRAY_AREF(ary, 0));
+            ts.tv_nsec = NUM2LONG(RARRAY_AREF(ary, 1));
+            return rboradb_time_to_timestamp(rb_time_timespec_new(&ts, INT_MAX));
+        }
+        return obj;
+    }
+    rb_raise(rb_eArgError, "unknown in_filter: %"PRIsVALUE, filter);
+}
+
+// Returns the text of a numeric value bound to NUMBER as bytes. BigDecimal
+// and Rational are converted without losing precision as far as NUMBER
+// can hold it.
+VALUE rboradb_number_to_text(VALUE obj)
+{
+    if (RB_INTEGER_TYPE_P(obj) || RB_FLOAT_TYPE_P(obj)) {
+        return rb_funcall(obj, id_to_s, 0);
+    }
+    if (RB_TYPE_P(obj, T_RATIONAL)) {
+        bigdecimal_class();
+        // NUMBER holds up to 40 significant digits.
+        obj = rb_funcall(rb_mKernel, id_BigDecimal, 2, obj, INT2FIX(40));
+    }
+    if (RB_TYPE_P(obj, T_DATA) && rb_const_defined(rb_cObject, id_BigDecimal) && rb_obj_is_kind_of(obj, bigdecimal_class())) {
+        return rb_funcall(obj, id_to_s, 1, rb_usascii_str_new_cstr("F"));
+    }
+    return obj;
+}
+
+VALUE rboradb_apply_filter(VALUE filter, VALUE obj, int in)
+{
+    if (!RB_SYMBOL_P(filter)) {
+        return rb_proc_call_with_block(filter, 1, &obj, Qnil);
+    }
+    return in ? in_filter(filter, obj) : out_filter(filter, obj);
+}
+
+void rboradb_filter_init(void)
+{
+    sym_to_sym = ID2SYM(rb_intern("to_sym"));
+    sym_strip = ID2SYM(rb_intern("strip"));
+    sym_to_time = ID2SYM(rb_intern("to_time"));
+    sym_to_utc_time = ID2SYM(rb_intern("to_utc_time"));
+    sym_to_date = ID2SYM(rb_intern("to_date"));
+    sym_epoch_ms = ID2SYM(rb_intern("epoch_ms"));
+    sym_epoch_ns = ID2SYM(rb_intern("epoch_ns"));
+    sym_to_bigdecimal = ID2SYM(rb_intern("to_bigdecimal"));
+    sym_bigdecimal = ID2SYM(rb_intern("bigdecimal"));
+    sym_to_bool_yn = ID2SYM(rb_intern("to_bool_yn"));
+    sym_frozen = ID2SYM(rb_intern("frozen"));
+    sym_dedup = ID2SYM(rb_intern("dedup"));
+    sym_to_i = ID2SYM(rb_intern("to_i"));
+    sym_to_f = ID2SYM(rb_intern("to_f"));
+    sym_column_dedup = ID2SYM(rb_intern("column_dedup"));
+    sym_symbolize_names = ID2SYM(rb_intern("symbolize_names"));
+    sym_to_json = ID2SYM(rb_intern("to_json"));
+    sym_lazy = ID2SYM(rb_intern("lazy"));
+    sym_from_json = ID2SYM(rb_intern("from_json"));
+    sym_to_struct = ID2SYM(rb_intern("to_struct"));
+
+    id_BigDecimal = rb_intern("BigDecimal");
+    id_to_s = rb_intern("to_s");
+    id_divmod = rb_intern("divmod");
+    id_to_sym = rb_intern("to_sym");
+    id_strip = rb_intern("strip");
+    id_civil = rb_intern("civil");
+    id_year = rb_intern("year");
+    id_mon = rb_intern("mon");
+    id_mday = rb_intern("mday");
+
+    rb_global_variable(&cDate);
+    rb_global_variable(&cBigDecimal);
+}
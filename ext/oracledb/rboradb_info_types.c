@@ -44,6 +44,13 @@ VALUE rboradb_from_dpiDataTypeInfo(const dpiDataTypeInfo *info, rbOraDBConn *dco
     IVAR_SET(obj, "@scale", INT2FIX(info->scale));
     IVAR_SET(obj, "@fs_precision", INT2FIX(info->fsPrecision));
     IVAR_SET(obj, "@object_type", info->objectType ? rboradb_from_dpiObjectType(info->objectType, dconn, 1) : Qnil);
+#ifdef RBORADB_HAVE_VECTOR
+    if (info->oracleTypeNum == DPI_ORACLE_TYPE_VECTOR) {
+        // zero when the column accepts any number of dimensions or any format
+        IVAR_SET(obj, "@vector_dimensions", info->vectorDimensions ? UINT2NUM(info->vectorDimensions) : Qnil);
+        IVAR_SET(obj, "@vector_format", info->vectorFormat ? rboradb_from_dpiVectorFormat(info->vectorFormat) : Qnil);
+    }
+#endif
     return obj;
 }
 
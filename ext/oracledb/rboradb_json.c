@@ -13,30 +13,145 @@
 // (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
 //-----------------------------------------------------------------------------
 #include "rboradb.h"
+#include <math.h>
 
 #define To_Json(obj) ((Json_t *)rb_check_typeddata((obj), &json_data_type))
 
-#define ALLOC_TMP_BUF(type, v, n) ((type*)rb_alloc_tmp_buffer2(&(v), (n), sizeof(type)))
+// Memory for dpiJsonNode trees passed to dpiJson_setValue() is taken from
+// an arena, a list of native blocks freed at once after the call. The first
+// block is sized by a pass over arrays and hashes, so that one block is
+// enough unless objects are converted by to_ary, to_hash or to_str.
+#define ARENA_ALIGN 8
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_MIN_BLOCK_SIZE 1024
+#define ARENA_ALLOC_N(enc, type, n) ((type *)arena_alloc((enc), sizeof(type) * (n)))
 
 static VALUE cJson;
 
 typedef struct {
     RBORADB_COMMON_HEADER(dpiJson);
+    dpiVar *var; // owner of the handle copied from fetched data or NULL
 } Json_t;
 
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+typedef struct {
+    arena_block_t *block;
+    VALUE gc_guard; // objects created while encoding or nil
+    VALUE obj;
+    dpiJson *handle;
+    rbOraDBConn *dconn;
+} json_encoder_t;
+
 struct hash_to_json_arg {
     long idx, size;
     dpiJsonObject *json_obj;
-    VALUE gc_guard;
+    json_encoder_t *enc;
 };
 
 static VALUE json_alloc(VALUE klass);
 static void json_free(void *arg);
-static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard);
-static void array_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard);
-static void hash_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard);
+static void ruby_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value);
+static void array_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value);
+static void hash_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value);
 static int hash_to_json_arg_i(VALUE key, VALUE value, VALUE arg);
 
+static void arena_add_block(json_encoder_t *enc, size_t size)
+{
+    arena_block_t *blk = xmalloc(sizeof(arena_block_t) + size);
+
+    blk->next = enc->block;
+    blk->size = size;
+    blk->used = 0;
+    enc->block = blk;
+}
+
+static void *arena_alloc(json_encoder_t *enc, size_t size)
+{
+    arena_block_t *blk = enc->block;
+    void *ptr;
+
+    size = ARENA_ROUND(size);
+    if (blk == NULL || blk->size - blk->used < size) {
+        arena_add_block(enc, size > ARENA_MIN_BLOCK_SIZE ? size : ARENA_MIN_BLOCK_SIZE);
+        blk = enc->block;
+    }
+    ptr = (char *)(blk + 1) + blk->used;
+    blk->used += size;
+    return ptr;
+}
+
+static void arena_free(json_encoder_t *enc)
+{
+    while (enc->block != NULL) {
+        arena_block_t *next = enc->block->next;
+        xfree(enc->block);
+        enc->block = next;
+    }
+}
+
+static int arena_size_i(VALUE key, VALUE value, VALUE arg);
+
+// Returns the arena size used by arrays and hashes in +value+.
+static size_t arena_size(VALUE value)
+{
+    size_t size = 0;
+    long idx, len;
+
+    switch (rb_type(value)) {
+    case T_ARRAY:
+        len = RARRAY_LEN(value);
+        size = ARENA_ROUND(sizeof(dpiJsonNode) * len) + ARENA_ROUND(sizeof(dpiDataBuffer) * len);
+        for (idx = 0; idx < len; idx++) {
+            size += arena_size(RARRAY_AREF(value, idx));
+        }
+        break;
+    case T_HASH:
+        len = RHASH_SIZE(value);
+        size = ARENA_ROUND(sizeof(char *) * len) + ARENA_ROUND(sizeof(uint32_t) * len)
+            + ARENA_ROUND(sizeof(dpiJsonNode) * len) + ARENA_ROUND(sizeof(dpiDataBuffer) * len);
+        rb_hash_foreach(value, arena_size_i, (VALUE)&size);
+        break;
+    default:
+        break;
+    }
+    return size;
+}
+
+static int arena_size_i(VALUE key, VALUE value, VALUE arg)
+{
+    *(size_t *)arg += arena_size(value);
+    return ST_CONTINUE;
+}
+
+static void json_encoder_guard(json_encoder_t *enc, VALUE obj)
+{
+    if (NIL_P(enc->gc_guard)) {
+        enc->gc_guard = rb_ary_new();
+    }
+    rb_ary_push(enc->gc_guard, obj);
+}
+
+// Gets UTF-8 bytes of +str+. Strings in UTF-8 or ASCII only strings are
+// used as is. Others are converted and copied to the arena.
+static void utf8_bytes(json_encoder_t *enc, VALUE str, char **ptr, uint32_t *len)
+{
+    VALUE utf8 = rboradb_export_utf8(str);
+
+    if (utf8 != str) {
+        str = utf8;
+        *ptr = arena_alloc(enc, RSTRING_LEN(str));
+        memcpy(*ptr, RSTRING_PTR(str), RSTRING_LEN(str));
+    } else {
+        *ptr = RSTRING_PTR(str);
+    }
+    *len = (uint32_t)RSTRING_LEN(str);
+}
+
 static inline void fixnum_to_json(dpiJsonNode *node, VALUE value)
 {
     node->oracleTypeNum = DPI_ORACLE_TYPE_NUMBER;
@@ -44,14 +159,27 @@ static inline void fixnum_to_json(dpiJsonNode *node, VALUE value)
     node->value->asInt64 = FIX2LONG(value);
 }
 
-static inline void bignum_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
+static inline void bignum_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value)
 {
-    StringValue(value);
+    value = rb_big2str(value, 10);
     node->oracleTypeNum = DPI_ORACLE_TYPE_NUMBER;
     node->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
-    node->value->asBytes.ptr = RSTRING_PTR(value);
+    node->value->asBytes.ptr = arena_alloc(enc, RSTRING_LEN(value));
     node->value->asBytes.length = RSTRING_LEN(value);
-    rb_ary_push(gc_guard, value);
+    memcpy(node->value->asBytes.ptr, RSTRING_PTR(value), RSTRING_LEN(value));
+}
+
+static inline void string_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value)
+{
+    node->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+    if (!ENCODING_IS_ASCII8BIT(value)) {
+        node->oracleTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        utf8_bytes(enc, value, &node->value->asBytes.ptr, &node->value->asBytes.length);
+    } else {
+        node->oracleTypeNum = DPI_ORACLE_TYPE_RAW;
+        node->value->asBytes.ptr = RSTRING_PTR(value);
+        node->value->asBytes.length = RSTRING_LEN(value);
+    }
 }
 
 static inline void timestamp_to_json(dpiJsonNode *node, VALUE value)
@@ -75,10 +203,15 @@ static inline void interval_ym_to_json(dpiJsonNode *node, VALUE value)
     node->value->asIntervalYM = *rboradb_to_dpiIntervalYM(value);
 }
 
+static size_t json_memsize(const void *arg)
+{
+    return sizeof(Json_t);
+}
+
 static const struct rb_data_type_struct json_data_type = {
     "OracleDB::Json",
-    {NULL, json_free,},
-    NULL, NULL,
+    {NULL, json_free, json_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE json_alloc(VALUE klass)
@@ -91,10 +224,28 @@ static void json_free(void *arg)
 {
     Json_t *json = (Json_t *)arg;
     RBORADB_RELEASE(json, dpiJson);
+    if (json->var) {
+        dpiVar_release(json->var);
+    }
     xfree(arg);
 }
 
-static VALUE json_to_ruby(const dpiJsonNode *node)
+// Field names are looked up in the global table of interned strings or
+// symbols. A new object is allocated only when a name appears first and
+// rb_hash_aset() stores interned strings without duplicating them.
+// Symbols are made by rb_str_intern(), which creates dynamic symbols
+// collected by GC, because field names come from data.
+static inline VALUE json_key(const char *ptr, uint32_t len, int flags)
+{
+    VALUE str = rb_enc_interned_str(ptr, len, rb_utf8_encoding());
+
+    if (flags & RBORADB_JSON_SYMBOLIZE_NAMES) {
+        return rb_str_intern(str);
+    }
+    return str;
+}
+
+static VALUE json_to_ruby(const dpiJsonNode *node, int flags)
 {
     VALUE obj, tmp;
     char *buf;
@@ -103,23 +254,27 @@ static VALUE json_to_ruby(const dpiJsonNode *node)
 
     switch (node->nativeTypeNum) {
     case DPI_NATIVE_TYPE_JSON_OBJECT:
+#ifdef HAVE_RB_HASH_NEW_CAPA
+        obj = rb_hash_new_capa(value->asJsonObject.numFields);
+#else
         obj = rb_hash_new();
+#endif
         for (idx = 0; idx < value->asJsonObject.numFields; idx++) {
-            VALUE key = rb_enc_str_new(value->asJsonObject.fieldNames[idx], value->asJsonObject.fieldNameLengths[idx], rb_utf8_encoding());
-            VALUE val = json_to_ruby(&value->asJsonObject.fields[idx]);
+            VALUE key = json_key(value->asJsonObject.fieldNames[idx], value->asJsonObject.fieldNameLengths[idx], flags);
+            VALUE val = json_to_ruby(&value->asJsonObject.fields[idx], flags);
             rb_hash_aset(obj, key, val);
         }
         return obj;
     case DPI_NATIVE_TYPE_JSON_ARRAY:
         obj = rb_ary_new_capa(node->value->asJsonArray.numElements);
         for (idx = 0; idx < value->asJsonArray.numElements; idx++) {
-            rb_ary_push(obj, json_to_ruby(&value->asJsonArray.elements[idx]));
+            rb_ary_push(obj, json_to_ruby(&value->asJsonArray.elements[idx], flags));
         }
         return obj;
     case DPI_NATIVE_TYPE_BYTES:
         switch (node->oracleTypeNum) {
         case DPI_ORACLE_TYPE_VARCHAR:
-            return rb_enc_str_new(value->asBytes.ptr, value->asBytes.length, rb_utf8_encoding());
+            return rboradb_enc_str_new(value->asBytes.ptr, value->asBytes.length, rb_utf8_encoding());
         case DPI_ORACLE_TYPE_RAW:
             return rb_str_new(value->asBytes.ptr, value->asBytes.length);
         case DPI_ORACLE_TYPE_NUMBER:
@@ -151,14 +306,358 @@ static VALUE json_to_ruby(const dpiJsonNode *node)
     rb_raise(rb_eRuntimeError, "unsupported native type num %d", node->nativeTypeNum);
 }
 
-static VALUE json_value(VALUE self)
+static void json_text_cat_string(VALUE buf, const char *ptr, uint32_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *end = ptr + len;
+    const char *start = ptr;
+    char esc[6] = {'\\', 'u', '0', '0', 0, 0};
+
+    rb_str_buf_cat(buf, "\"", 1);
+    for (; ptr < end; ptr++) {
+        unsigned char c = (unsigned char)*ptr;
+        const char *rep;
+        long rep_len = 2;
+
+        switch (c) {
+        case '"': rep = "\\\""; break;
+        case '\\': rep = "\\\\"; break;
+        case '\b': rep = "\\b"; break;
+        case '\f': rep = "\\f"; break;
+        case '\n': rep = "\\n"; break;
+        case '\r': rep = "\\r"; break;
+        case '\t': rep = "\\t"; break;
+        default:
+            if (c >= 0x20) {
+                continue;
+            }
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xF];
+            rep = esc;
+            rep_len = 6;
+        }
+        rb_str_buf_cat(buf, start, ptr - start);
+        rb_str_buf_cat(buf, rep, rep_len);
+        start = ptr + 1;
+    }
+    rb_str_buf_cat(buf, start, ptr - start);
+    rb_str_buf_cat(buf, "\"", 1);
+}
+
+static void json_text_cat_double(VALUE buf, double val)
+{
+    char str[32];
+    int prec;
+
+    if (!isfinite(val)) {
+        rb_str_buf_cat(buf, "null", 4);
+        return;
+    }
+    // the shortest representation which is read back to the same value
+    for (prec = 15; prec < 17; prec++) {
+        snprintf(str, sizeof(str), "%.*g", prec, val);
+        if (strtod(str, NULL) == val) {
+            break;
+        }
+    }
+    if (prec == 17) {
+        snprintf(str, sizeof(str), "%.17g", val);
+    }
+    rb_str_buf_cat2(buf, str);
+}
+
+// Appends a value in ISO 8601 format as json_serialize() does.
+static void json_text_cat_datetime(VALUE buf, const dpiJsonNode *node)
+{
+    const dpiDataBuffer *value = node->value;
+    char str[64];
+    int len;
+
+    switch (node->nativeTypeNum) {
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        len = snprintf(str, sizeof(str), "\"%04d-%02d-%02dT%02d:%02d:%02d",
+                       value->asTimestamp.year, value->asTimestamp.month, value->asTimestamp.day,
+                       value->asTimestamp.hour, value->asTimestamp.minute, value->asTimestamp.second);
+        if (value->asTimestamp.fsecond != 0) {
+            len += snprintf(str + len, sizeof(str) - len, ".%09u", value->asTimestamp.fsecond);
+            while (str[len - 1] == '0') {
+                len--;
+            }
+        }
+        if (value->asTimestamp.tzHourOffset != 0 || value->asTimestamp.tzMinuteOffset != 0) {
+            char sign = (value->asTimestamp.tzHourOffset >= 0 && value->asTimestamp.tzMinuteOffset >= 0) ? '+' : '-';
+            len += snprintf(str + len, sizeof(str) - len, "%c%02d:%02d", sign,
+                            abs(value->asTimestamp.tzHourOffset), abs(value->asTimestamp.tzMinuteOffset));
+        }
+        break;
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+        {
+            const dpiIntervalDS *ds = &value->asIntervalDS;
+            int neg = ds->days < 0 || ds->hours < 0 || ds->minutes < 0 || ds->seconds < 0 || ds->fseconds < 0;
+
+            len = snprintf(str, sizeof(str), "\"%sP%dDT%dH%dM%d", neg ? "-" : "",
+                           abs(ds->days), abs(ds->hours), abs(ds->minutes), abs(ds->seconds));
+            if (ds->fseconds != 0) {
+                len += snprintf(str + len, sizeof(str) - len, ".%09d", abs(ds->fseconds));
+                while (str[len - 1] == '0') {
+                    len--;
+                }
+            }
+            str[len++] = 'S';
+        }
+        break;
+    default: // DPI_NATIVE_TYPE_INTERVAL_YM
+        {
+            const dpiIntervalYM *ym = &value->asIntervalYM;
+            int neg = ym->years < 0 || ym->months < 0;
+
+            len = snprintf(str, sizeof(str), "\"%sP%dY%dM", neg ? "-" : "", abs(ym->years), abs(ym->months));
+        }
+        break;
+    }
+    str[len++] = '"';
+    rb_str_buf_cat(buf, str, len);
+}
+
+// Serializes a JSON node tree to compact JSON text without creating ruby
+// objects for values.
+static void json_to_text(const dpiJsonNode *node, VALUE buf)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const dpiDataBuffer *value = node->value;
+    uint32_t idx;
+
+    switch (node->nativeTypeNum) {
+    case DPI_NATIVE_TYPE_JSON_OBJECT:
+        rb_str_buf_cat(buf, "{", 1);
+        for (idx = 0; idx < value->asJsonObject.numFields; idx++) {
+            if (idx != 0) {
+                rb_str_buf_cat(buf, ",", 1);
+            }
+            json_text_cat_string(buf, value->asJsonObject.fieldNames[idx], value->asJsonObject.fieldNameLengths[idx]);
+            rb_str_buf_cat(buf, ":", 1);
+            json_to_text(&value->asJsonObject.fields[idx], buf);
+        }
+        rb_str_buf_cat(buf, "}", 1);
+        return;
+    case DPI_NATIVE_TYPE_JSON_ARRAY:
+        rb_str_buf_cat(buf, "[", 1);
+        for (idx = 0; idx < value->asJsonArray.numElements; idx++) {
+            if (idx != 0) {
+                rb_str_buf_cat(buf, ",", 1);
+            }
+            json_to_text(&value->asJsonArray.elements[idx], buf);
+        }
+        rb_str_buf_cat(buf, "]", 1);
+        return;
+    case DPI_NATIVE_TYPE_BYTES:
+        switch (node->oracleTypeNum) {
+        case DPI_ORACLE_TYPE_VARCHAR:
+            json_text_cat_string(buf, value->asBytes.ptr, value->asBytes.length);
+            return;
+        case DPI_ORACLE_TYPE_RAW:
+            rb_str_buf_cat(buf, "\"", 1);
+            for (idx = 0; idx < value->asBytes.length; idx++) {
+                unsigned char c = (unsigned char)value->asBytes.ptr[idx];
+                char str[2] = {hex[c >> 4], hex[c & 0xF]};
+                rb_str_buf_cat(buf, str, 2);
+            }
+            rb_str_buf_cat(buf, "\"", 1);
+            return;
+        case DPI_ORACLE_TYPE_NUMBER:
+            rb_str_buf_cat(buf, value->asBytes.ptr, value->asBytes.length);
+            return;
+        }
+        break;
+    case DPI_NATIVE_TYPE_DOUBLE:
+        json_text_cat_double(buf, value->asDouble);
+        return;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+    case DPI_NATIVE_TYPE_INTERVAL_YM:
+        json_text_cat_datetime(buf, node);
+        return;
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        if (value->asBoolean) {
+            rb_str_buf_cat(buf, "true", 4);
+        } else {
+            rb_str_buf_cat(buf, "false", 5);
+        }
+        return;
+    case DPI_NATIVE_TYPE_NULL:
+        rb_str_buf_cat(buf, "null", 4);
+        return;
+    }
+    rb_raise(rb_eRuntimeError, "unsupported native type num %d", node->nativeTypeNum);
+}
+
+static VALUE json___value(VALUE self, VALUE symbolize_names)
+{
+    Json_t *json = To_Json(self);
+
+    return rboradb_dpiJson2ruby(json->handle, json->dconn, RTEST(symbolize_names) ? RBORADB_JSON_SYMBOLIZE_NAMES : 0);
+}
+
+static VALUE json_to_json(int argc, VALUE *argv, VALUE self)
 {
     Json_t *json = To_Json(self);
 
-    return rboradb_dpiJson2ruby(json->handle, json->dconn);
+    return rboradb_dpiJson2ruby(json->handle, json->dconn, RBORADB_JSON_TEXT);
+}
+
+static dpiJsonNode *json_top_node(Json_t *json)
+{
+    dpiJsonNode *top_node;
+
+    if (dpiJson_getValue(json->handle, DPI_JSON_OPT_NUMBER_AS_STRING, &top_node) != DPI_SUCCESS) {
+        RBORADB_RAISE_ERROR(json);
+    }
+    return top_node;
+}
+
+static dpiJsonNode *json_field(dpiJsonNode *node, const char *name, long len)
+{
+    dpiJsonObject *obj = &node->value->asJsonObject;
+    uint32_t idx;
+
+    if (node->nativeTypeNum != DPI_NATIVE_TYPE_JSON_OBJECT) {
+        return NULL;
+    }
+    for (idx = 0; idx < obj->numFields; idx++) {
+        if (obj->fieldNameLengths[idx] == len && memcmp(obj->fieldNames[idx], name, len) == 0) {
+            return &obj->fields[idx];
+        }
+    }
+    return NULL;
+}
+
+static dpiJsonNode *json_element(dpiJsonNode *node, long idx)
+{
+    dpiJsonArray *ary = &node->value->asJsonArray;
+
+    if (node->nativeTypeNum != DPI_NATIVE_TYPE_JSON_ARRAY) {
+        return NULL;
+    }
+    if (idx < 0) {
+        idx += ary->numElements;
+    }
+    if (idx < 0 || idx >= (long)ary->numElements) {
+        return NULL;
+    }
+    return &ary->elements[idx];
+}
+
+// Converts only the value at +path+, keys of objects or indexes of arrays,
+// to ruby objects. It returns nil when the value isn't found as Hash#dig.
+static VALUE json_dig(int argc, VALUE *argv, VALUE self)
+{
+    dpiJsonNode *node = json_top_node(To_Json(self));
+    int i;
+
+    for (i = 0; i < argc && node != NULL; i++) {
+        VALUE key = argv[i];
+
+        if (RB_INTEGER_TYPE_P(key)) {
+            node = json_element(node, NUM2LONG(key));
+        } else {
+            if (RB_SYMBOL_P(key)) {
+                key = rb_sym2str(key);
+            }
+            ExportString(key);
+            node = json_field(node, RSTRING_PTR(key), RSTRING_LEN(key));
+        }
+    }
+    return node ? json_to_ruby(node, 0) : Qnil;
+}
+
+NORETURN(static void json_path_error(VALUE path));
+static void json_path_error(VALUE path)
+{
+    rb_raise(rb_eArgError, "unsupported JSON path: %"PRIsVALUE, path);
+}
+
+// Converts the value at a simple JSON path such as $.a."b c"[0]['d']
+// to ruby objects. Wildcards, array ranges, filters and item methods
+// aren't supported.
+static VALUE json_at(VALUE self, VALUE path)
+{
+    dpiJsonNode *node;
+    const char *ptr, *end;
+
+    ExportString(path);
+    node = json_top_node(To_Json(self));
+    ptr = RSTRING_PTR(path);
+    end = ptr + RSTRING_LEN(path);
+    if (ptr == end || *ptr != '$') {
+        json_path_error(path);
+    }
+    ptr++;
+    while (ptr < end && node != NULL) {
+        const char *name;
+        long len;
+
+        if (*ptr == '.') {
+            ptr++;
+            if (ptr < end && *ptr == '"') {
+                name = ++ptr;
+                while (ptr < end && *ptr != '"' && *ptr != '\\') {
+                    ptr++;
+                }
+                if (ptr == end || *ptr != '"') {
+                    json_path_error(path);
+                }
+                len = ptr++ - name;
+            } else {
+                name = ptr;
+                while (ptr < end && (ISALNUM(*ptr) || *ptr == '_' || *ptr == '$' || (*ptr & 0x80))) {
+                    ptr++;
+                }
+                len = ptr - name;
+                if (len == 0) {
+                    json_path_error(path);
+                }
+            }
+            node = json_field(node, name, len);
+        } else if (*ptr == '[') {
+            ptr++;
+            if (ptr < end && (*ptr == '"' || *ptr == '\'')) {
+                char quote = *ptr;
+                name = ++ptr;
+                while (ptr < end && *ptr != quote && *ptr != '\\') {
+                    ptr++;
+                }
+                if (ptr == end || *ptr != quote) {
+                    json_path_error(path);
+                }
+                len = ptr++ - name;
+                node = json_field(node, name, len);
+            } else {
+                long idx = 0;
+
+                if (ptr == end || !ISDIGIT(*ptr)) {
+                    json_path_error(path);
+                }
+                while (ptr < end && ISDIGIT(*ptr)) {
+                    if (idx > (LONG_MAX - 9) / 10) {
+                        json_path_error(path);
+                    }
+                    idx = idx * 10 + (*ptr++ - '0');
+                }
+                node = json_element(node, idx);
+            }
+            if (ptr == end || *ptr != ']') {
+                json_path_error(path);
+            }
+            ptr++;
+        } else {
+            json_path_error(path);
+        }
+    }
+    RB_GC_GUARD(path);
+    return node ? json_to_ruby(node, 0) : Qnil;
 }
 
-static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
+static void ruby_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value)
 {
     enum ruby_value_type value_type = rb_type(value);
     ID id;
@@ -188,13 +687,16 @@ static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
         fixnum_to_json(node, value);
         return;
     case T_BIGNUM:
-        bignum_to_json(node, value, gc_guard);
+        bignum_to_json(enc, node, value);
         return;
     case T_ARRAY:
-        array_to_json(node, value, gc_guard);
+        array_to_json(enc, node, value);
         return;
     case T_HASH:
-        hash_to_json(node, value, gc_guard);
+        hash_to_json(enc, node, value);
+        return;
+    case T_STRING:
+        string_to_json(enc, node, value);
         return;
     default:
         ;
@@ -219,7 +721,7 @@ static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
             fixnum_to_json(node, tmp);
             return;
         case T_BIGNUM:
-            bignum_to_json(node, tmp, gc_guard);
+            bignum_to_json(enc, node, tmp);
             return;
         default:
             break;
@@ -229,23 +731,24 @@ static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
     if (rb_respond_to(value, id)) {
         tmp = rb_funcall(value, id, 0);
         if (rb_type(tmp) == T_ARRAY) {
-            rb_ary_push(gc_guard, tmp);
-            array_to_json(node, tmp, gc_guard);
+            json_encoder_guard(enc, tmp);
+            array_to_json(enc, node, tmp);
+            return;
         }
     }
     CONST_ID(id, "to_hash");
     if (rb_respond_to(value, id)) {
         tmp = rb_funcall(value, id, 0);
         if (rb_type(tmp) == T_HASH) {
-            rb_ary_push(gc_guard, tmp);
-            array_to_json(node, tmp, gc_guard);
+            json_encoder_guard(enc, tmp);
+            hash_to_json(enc, node, tmp);
+            return;
         }
     }
     CONST_ID(id, "to_oracle_timestamp");
     if (rb_respond_to(value, id)) {
         tmp = rb_funcall(value, id, 0);
         if (rboradb_is_Timestamp(tmp)) {
-            rb_ary_push(gc_guard, tmp);
             timestamp_to_json(node, tmp);
             return;
         }
@@ -254,7 +757,6 @@ static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
     if (rb_respond_to(value, id)) {
         tmp = rb_funcall(value, id, 0);
         if (rboradb_is_IntervalDS(tmp)) {
-            rb_ary_push(gc_guard, tmp);
             interval_ds_to_json(node, tmp);
             return;
         }
@@ -263,65 +765,51 @@ static void ruby_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
     if (rb_respond_to(value, id)) {
         tmp = rb_funcall(value, id, 0);
         if (rboradb_is_IntervalYM(tmp)) {
-            rb_ary_push(gc_guard, tmp);
             interval_ym_to_json(node, tmp);
             return;
         }
     }
-    StringValue(value);
-    if (!ENCODING_IS_ASCII8BIT(value)) {
-        value = rb_str_export_to_enc(value, rb_utf8_encoding());
-        node->oracleTypeNum = DPI_ORACLE_TYPE_VARCHAR;
-    } else {
-        node->oracleTypeNum = DPI_ORACLE_TYPE_RAW;
-    }
-    node->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
-    node->value->asBytes.ptr = RSTRING_PTR(value);
-    node->value->asBytes.length = RSTRING_LEN(value);
-    rb_ary_push(gc_guard, value);
+    value = rb_str_to_str(value);
+    json_encoder_guard(enc, value);
+    string_to_json(enc, node, value);
 }
 
-static void array_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
+static void array_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value)
 {
-    VALUE tmp;
     long idx, size;
 
     node->oracleTypeNum = DPI_ORACLE_TYPE_JSON_ARRAY;
     node->nativeTypeNum = DPI_NATIVE_TYPE_JSON_ARRAY;
     size = RARRAY_LEN(value);
     node->value->asJsonArray.numElements = size;
-    node->value->asJsonArray.elements = ALLOC_TMP_BUF(dpiJsonNode, tmp, size);
-    rb_ary_push(gc_guard, tmp);
-    node->value->asJsonArray.elementValues = ALLOC_TMP_BUF(dpiDataBuffer, tmp, size);
-    rb_ary_push(gc_guard, tmp);
+    node->value->asJsonArray.elements = ARENA_ALLOC_N(enc, dpiJsonNode, size);
+    node->value->asJsonArray.elementValues = ARENA_ALLOC_N(enc, dpiDataBuffer, size);
     for (idx = 0; idx < size; idx++) {
         node->value->asJsonArray.elements[idx].value = &node->value->asJsonArray.elementValues[idx];
-        ruby_to_json(&node->value->asJsonArray.elements[idx], RARRAY_AREF(value, idx), gc_guard);
+        ruby_to_json(enc, &node->value->asJsonArray.elements[idx], RARRAY_AREF(value, idx));
     }
 }
 
-static void hash_to_json(dpiJsonNode *node, VALUE value, VALUE gc_guard)
+static void hash_to_json(json_encoder_t *enc, dpiJsonNode *node, VALUE value)
 {
-    VALUE tmp;
-    long size;
+    long idx, size;
     struct hash_to_json_arg hash_to_json_arg;
 
     node->oracleTypeNum = DPI_ORACLE_TYPE_JSON_OBJECT;
     node->nativeTypeNum = DPI_NATIVE_TYPE_JSON_OBJECT;
     size = RHASH_SIZE(value);
     node->value->asJsonObject.numFields = size;
-    node->value->asJsonObject.fieldNames = ALLOC_TMP_BUF(char *, tmp, size);
-    rb_ary_push(gc_guard, tmp);
-    node->value->asJsonObject.fieldNameLengths = ALLOC_TMP_BUF(uint32_t, tmp, size);
-    rb_ary_push(gc_guard, tmp);
-    node->value->asJsonObject.fields = ALLOC_TMP_BUF(dpiJsonNode, tmp, size);
-    rb_ary_push(gc_guard, tmp);
-    node->value->asJsonObject.fieldValues = ALLOC_TMP_BUF(dpiDataBuffer, tmp, size);
-    rb_ary_push(gc_guard, tmp);
+    node->value->asJsonObject.fieldNames = ARENA_ALLOC_N(enc, char *, size);
+    node->value->asJsonObject.fieldNameLengths = ARENA_ALLOC_N(enc, uint32_t, size);
+    node->value->asJsonObject.fields = ARENA_ALLOC_N(enc, dpiJsonNode, size);
+    node->value->asJsonObject.fieldValues = ARENA_ALLOC_N(enc, dpiDataBuffer, size);
+    for (idx = 0; idx < size; idx++) {
+        node->value->asJsonObject.fields[idx].value = &node->value->asJsonObject.fieldValues[idx];
+    }
     hash_to_json_arg.idx = 0;
     hash_to_json_arg.size = size;
     hash_to_json_arg.json_obj = &node->value->asJsonObject;
-    hash_to_json_arg.gc_guard = gc_guard;
+    hash_to_json_arg.enc = enc;
     rb_hash_foreach(value, hash_to_json_arg_i, (VALUE)&hash_to_json_arg);
 }
 
@@ -333,15 +821,409 @@ static int hash_to_json_arg_i(VALUE key, VALUE value, VALUE arg)
         rb_raise(rb_eRuntimeError, "unexpected out of range while iterating hash");
     }
 
-    ExportString(key);
-    rb_ary_push(args->gc_guard, key);
-    args->json_obj->fieldNames[args->idx] = RSTRING_PTR(key);
-    args->json_obj->fieldNameLengths[args->idx] = RSTRING_LEN(key);
-    ruby_to_json(&args->json_obj->fields[args->idx], value, args->gc_guard);
+    if (RB_SYMBOL_P(key)) {
+        key = rb_sym2str(key);
+    } else if (!RB_TYPE_P(key, T_STRING)) {
+        key = rb_str_to_str(key);
+        json_encoder_guard(args->enc, key);
+    }
+    utf8_bytes(args->enc, key, &args->json_obj->fieldNames[args->idx], &args->json_obj->fieldNameLengths[args->idx]);
+    ruby_to_json(args->enc, &args->json_obj->fields[args->idx], value);
     args->idx++;
     return ST_CONTINUE;
 }
 
+// A parser of JSON text building a node tree in an arena. Strings without
+// escape sequences refer to the text itself. Children of arrays and
+// objects are kept in a stack until the closing bracket, when the number
+// of them is known, and then copied to the arena.
+#define JSON_MAX_NESTING 1000
+#define SWAR_ONES UINT64_C(0x0101010101010101)
+#define SWAR_HIGHS UINT64_C(0x8080808080808080)
+
+typedef struct {
+    char *name;
+    uint32_t name_len;
+    dpiJsonNode node;
+    dpiDataBuffer value;
+} json_item_t;
+
+typedef struct {
+    json_encoder_t enc;
+    const char *start;
+    const char *ptr;
+    const char *end;
+    json_item_t *items;
+    long num_items;
+    long items_capa;
+    int depth;
+} json_parser_t;
+
+static void parse_value(json_parser_t *p, dpiJsonNode *node);
+
+NORETURN(static void parse_error(json_parser_t *p));
+static void parse_error(json_parser_t *p)
+{
+    if (p->ptr >= p->end) {
+        rb_raise(rb_eArgError, "unexpected end of JSON text");
+    }
+    rb_raise(rb_eArgError, "invalid JSON text at offset %ld", (long)(p->ptr - p->start));
+}
+
+static inline void skip_ws(json_parser_t *p)
+{
+    while (p->ptr < p->end && (*p->ptr == ' ' || *p->ptr == '\n' || *p->ptr == '\r' || *p->ptr == '\t')) {
+        p->ptr++;
+    }
+}
+
+static inline void expect_char(json_parser_t *p, char c)
+{
+    skip_ws(p);
+    if (p->ptr >= p->end || *p->ptr != c) {
+        parse_error(p);
+    }
+    p->ptr++;
+}
+
+static void push_item(json_parser_t *p, char *name, uint32_t name_len, const dpiJsonNode *node)
+{
+    json_item_t *item;
+
+    if (p->num_items == p->items_capa) {
+        p->items_capa = p->items_capa ? p->items_capa * 2 : 64;
+        REALLOC_N(p->items, json_item_t, p->items_capa);
+    }
+    item = &p->items[p->num_items++];
+    item->name = name;
+    item->name_len = name_len;
+    item->node = *node;
+    item->value = *node->value;
+}
+
+// Returns nonzero when 8 bytes in +v+ contain '"', '\\' or a control
+// character.
+static inline int swar_has_special(uint64_t v)
+{
+    uint64_t q = v ^ (SWAR_ONES * '"');
+    uint64_t b = v ^ (SWAR_ONES * '\\');
+
+    return (((q - SWAR_ONES) & ~q) | ((b - SWAR_ONES) & ~b) | ((v - SWAR_ONES * 0x20) & ~v)) & SWAR_HIGHS ? 1 : 0;
+}
+
+static int hex_value(json_parser_t *p)
+{
+    int i, val = 0;
+
+    if (p->end - p->ptr < 4) {
+        parse_error(p);
+    }
+    for (i = 0; i < 4; i++) {
+        char c = *p->ptr;
+        val <<= 4;
+        if ('0' <= c && c <= '9') {
+            val |= c - '0';
+        } else if ('a' <= c && c <= 'f') {
+            val |= c - 'a' + 10;
+        } else if ('A' <= c && c <= 'F') {
+            val |= c - 'A' + 10;
+        } else {
+            parse_error(p);
+        }
+        p->ptr++;
+    }
+    return val;
+}
+
+static void parse_string(json_parser_t *p, char **str, uint32_t *len)
+{
+    const char *start = ++p->ptr;
+    char *buf, *dst;
+
+    while (p->end - p->ptr >= 8) {
+        uint64_t v;
+        memcpy(&v, p->ptr, 8);
+        if (swar_has_special(v)) {
+            break;
+        }
+        p->ptr += 8;
+    }
+    while (p->ptr < p->end && *p->ptr != '"' && *p->ptr != '\\' && (unsigned char)*p->ptr >= 0x20) {
+        p->ptr++;
+    }
+    if (p->ptr >= p->end || (unsigned char)*p->ptr < 0x20) {
+        parse_error(p);
+    }
+    if (*p->ptr == '"') {
+        *str = (char *)start;
+        *len = (uint32_t)(p->ptr++ - start);
+        return;
+    }
+    // Unescaped text is never longer than the escaped one.
+    for (dst = (char *)p->ptr; dst < p->end && *dst != '"'; dst++) {
+        if (*dst == '\\') {
+            dst++;
+        }
+    }
+    buf = arena_alloc(&p->enc, dst - start);
+    memcpy(buf, start, p->ptr - start);
+    dst = buf + (p->ptr - start);
+    while (1) {
+        unsigned char c;
+        int code;
+
+        if (p->ptr >= p->end) {
+            parse_error(p);
+        }
+        c = (unsigned char)*p->ptr;
+        if (c == '"') {
+            p->ptr++;
+            break;
+        }
+        if (c < 0x20) {
+            parse_error(p);
+        }
+        if (c != '\\') {
+            *dst++ = c;
+            p->ptr++;
+            continue;
+        }
+        if (++p->ptr >= p->end) {
+            parse_error(p);
+        }
+        switch (*p->ptr++) {
+        case '"': *dst++ = '"'; break;
+        case '\\': *dst++ = '\\'; break;
+        case '/': *dst++ = '/'; break;
+        case 'b': *dst++ = '\b'; break;
+        case 'f': *dst++ = '\f'; break;
+        case 'n': *dst++ = '\n'; break;
+        case 'r': *dst++ = '\r'; break;
+        case 't': *dst++ = '\t'; break;
+        case 'u':
+            code = hex_value(p);
+            if (0xD800 <= code && code < 0xDC00) {
+                int low;
+                if (p->end - p->ptr < 2 || p->ptr[0] != '\\' || p->ptr[1] != 'u') {
+                    parse_error(p);
+                }
+                p->ptr += 2;
+                low = hex_value(p);
+                if (low < 0xDC00 || 0xE000 <= low) {
+                    parse_error(p);
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else if (0xDC00 <= code && code < 0xE000) {
+                parse_error(p);
+            }
+            dst += rb_enc_mbcput(code, dst, rb_utf8_encoding());
+            break;
+        default:
+            p->ptr--;
+            parse_error(p);
+        }
+    }
+    *str = buf;
+    *len = (uint32_t)(dst - buf);
+}
+
+static void parse_number(json_parser_t *p, dpiJsonNode *node)
+{
+    const char *start = p->ptr;
+
+    if (*p->ptr == '-') {
+        p->ptr++;
+    }
+    if (p->ptr < p->end && *p->ptr == '0') {
+        p->ptr++;
+    } else if (p->ptr < p->end && ISDIGIT(*p->ptr)) {
+        while (p->ptr < p->end && ISDIGIT(*p->ptr)) {
+            p->ptr++;
+        }
+    } else {
+        parse_error(p);
+    }
+    if (p->ptr < p->end && *p->ptr == '.') {
+        p->ptr++;
+        if (p->ptr >= p->end || !ISDIGIT(*p->ptr)) {
+            parse_error(p);
+        }
+        while (p->ptr < p->end && ISDIGIT(*p->ptr)) {
+            p->ptr++;
+        }
+    }
+    if (p->ptr < p->end && (*p->ptr == 'e' || *p->ptr == 'E')) {
+        p->ptr++;
+        if (p->ptr < p->end && (*p->ptr == '+' || *p->ptr == '-')) {
+            p->ptr++;
+        }
+        if (p->ptr >= p->end || !ISDIGIT(*p->ptr)) {
+            parse_error(p);
+        }
+        while (p->ptr < p->end && ISDIGIT(*p->ptr)) {
+            p->ptr++;
+        }
+    }
+    node->oracleTypeNum = DPI_ORACLE_TYPE_NUMBER;
+    node->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+    node->value->asBytes.ptr = (char *)start;
+    node->value->asBytes.length = (uint32_t)(p->ptr - start);
+}
+
+static void parse_literal(json_parser_t *p, const char *literal, long len)
+{
+    if (p->end - p->ptr < len || memcmp(p->ptr, literal, len) != 0) {
+        parse_error(p);
+    }
+    p->ptr += len;
+}
+
+static void parse_container(json_parser_t *p, dpiJsonNode *node, int is_object)
+{
+    long base = p->num_items;
+    long idx, num;
+    char close = is_object ? '}' : ']';
+
+    if (++p->depth > JSON_MAX_NESTING) {
+        rb_raise(rb_eArgError, "nesting of JSON text is too deep");
+    }
+    p->ptr++;
+    skip_ws(p);
+    if (p->ptr < p->end && *p->ptr == close) {
+        p->ptr++;
+    } else {
+        while (1) {
+            char *name = NULL;
+            uint32_t name_len = 0;
+            dpiJsonNode child;
+            dpiDataBuffer value;
+
+            if (is_object) {
+                skip_ws(p);
+                if (p->ptr >= p->end || *p->ptr != '"') {
+                    parse_error(p);
+                }
+                parse_string(p, &name, &name_len);
+                expect_char(p, ':');
+            }
+            child.value = &value;
+            parse_value(p, &child);
+            push_item(p, name, name_len, &child);
+            skip_ws(p);
+            if (p->ptr < p->end && *p->ptr == ',') {
+                p->ptr++;
+                continue;
+            }
+            expect_char(p, close);
+            break;
+        }
+    }
+    num = p->num_items - base;
+    if (is_object) {
+        dpiJsonObject *obj = &node->value->asJsonObject;
+
+        node->oracleTypeNum = DPI_ORACLE_TYPE_JSON_OBJECT;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_JSON_OBJECT;
+        obj->numFields = num;
+        obj->fieldNames = ARENA_ALLOC_N(&p->enc, char *, num);
+        obj->fieldNameLengths = ARENA_ALLOC_N(&p->enc, uint32_t, num);
+        obj->fields = ARENA_ALLOC_N(&p->enc, dpiJsonNode, num);
+        obj->fieldValues = ARENA_ALLOC_N(&p->enc, dpiDataBuffer, num);
+        for (idx = 0; idx < num; idx++) {
+            json_item_t *item = &p->items[base + idx];
+            obj->fieldNames[idx] = item->name;
+            obj->fieldNameLengths[idx] = item->name_len;
+            obj->fields[idx] = item->node;
+            obj->fieldValues[idx] = item->value;
+            obj->fields[idx].value = &obj->fieldValues[idx];
+        }
+    } else {
+        dpiJsonArray *ary = &node->value->asJsonArray;
+
+        node->oracleTypeNum = DPI_ORACLE_TYPE_JSON_ARRAY;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_JSON_ARRAY;
+        ary->numElements = num;
+        ary->elements = ARENA_ALLOC_N(&p->enc, dpiJsonNode, num);
+        ary->elementValues = ARENA_ALLOC_N(&p->enc, dpiDataBuffer, num);
+        for (idx = 0; idx < num; idx++) {
+            json_item_t *item = &p->items[base + idx];
+            ary->elements[idx] = item->node;
+            ary->elementValues[idx] = item->value;
+            ary->elements[idx].value = &ary->elementValues[idx];
+        }
+    }
+    p->num_items = base;
+    p->depth--;
+}
+
+static void parse_value(json_parser_t *p, dpiJsonNode *node)
+{
+    skip_ws(p);
+    if (p->ptr >= p->end) {
+        parse_error(p);
+    }
+    switch (*p->ptr) {
+    case '{':
+        parse_container(p, node, 1);
+        return;
+    case '[':
+        parse_container(p, node, 0);
+        return;
+    case '"':
+        node->oracleTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        parse_string(p, &node->value->asBytes.ptr, &node->value->asBytes.length);
+        return;
+    case 't':
+        parse_literal(p, "true", 4);
+        node->oracleTypeNum = DPI_ORACLE_TYPE_BOOLEAN;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_BOOLEAN;
+        node->value->asBoolean = 1;
+        return;
+    case 'f':
+        parse_literal(p, "false", 5);
+        node->oracleTypeNum = DPI_ORACLE_TYPE_BOOLEAN;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_BOOLEAN;
+        node->value->asBoolean = 0;
+        return;
+    case 'n':
+        parse_literal(p, "null", 4);
+        node->oracleTypeNum = DPI_ORACLE_TYPE_NONE;
+        node->nativeTypeNum = DPI_NATIVE_TYPE_NULL;
+        return;
+    default:
+        parse_number(p, node);
+    }
+}
+
+static VALUE json_parse(VALUE arg)
+{
+    json_parser_t *p = (json_parser_t *)arg;
+    dpiJsonNode top_node;
+    dpiDataBuffer buf;
+    top_node.value = &buf;
+
+    parse_value(p, &top_node);
+    skip_ws(p);
+    if (p->ptr != p->end) {
+        parse_error(p);
+    }
+    if (dpiJson_setValue(p->enc.handle, &top_node) != DPI_SUCCESS) {
+        rboradb_raise_error(p->enc.dconn->ctxt);
+    }
+    return Qnil;
+}
+
+static VALUE json_parser_free(VALUE arg)
+{
+    json_parser_t *p = (json_parser_t *)arg;
+
+    arena_free(&p->enc);
+    xfree(p->items);
+    p->items = NULL;
+    return Qnil;
+}
+
 static VALUE json_set_value(VALUE self, VALUE value)
 {
     Json_t *json = To_Json(self);
@@ -349,36 +1231,114 @@ static VALUE json_set_value(VALUE self, VALUE value)
     return Qnil;
 }
 
+static VALUE json_set_value_from_text(VALUE self, VALUE text)
+{
+    Json_t *json = To_Json(self);
+    rboradb_text2dpiJson(text, json->handle, json->dconn);
+    return Qnil;
+}
+
 void rboradb_json_init(VALUE mOracleDB)
 {
     cJson = rb_define_class_under(mOracleDB, "Json", rb_cObject);
     rb_define_alloc_func(cJson, json_alloc);
     rb_define_private_method(cJson, "initialize", rboradb_notimplement, -1);
     rb_define_private_method(cJson, "initialize_copy", rboradb_notimplement, -1);
-    rb_define_method(cJson, "value", json_value, 0);
+    rb_define_private_method(cJson, "__value", json___value, 1);
+    rb_define_method(cJson, "to_json", json_to_json, -1);
+    rb_define_method(cJson, "dig", json_dig, -1);
+    rb_define_method(cJson, "at", json_at, 1);
     rb_define_method(cJson, "value=", json_set_value, 1);
+    rb_define_method(cJson, "value_from_text=", json_set_value_from_text, 1);
 }
 
-VALUE rboradb_dpiJson2ruby(dpiJson *handle, rbOraDBConn *dconn)
+// Fetched JSON data are overwritten by the next fetch. The value is copied
+// to a JSON variable owned by the returned object.
+VALUE rboradb_from_dpiJson(dpiJson *handle, rbOraDBConn *dconn)
 {
+    Json_t *json;
+    VALUE obj = TypedData_Make_Struct(cJson, Json_t, &json_data_type, json);
     dpiJsonNode *top_node;
+    dpiData *data;
 
     if (dpiJson_getValue(handle, DPI_JSON_OPT_NUMBER_AS_STRING, &top_node) != DPI_SUCCESS) {
         rboradb_raise_error(dconn->ctxt);
     }
-    return json_to_ruby(top_node);
+    if (dpiConn_newVar(dconn->handle, DPI_ORACLE_TYPE_JSON, DPI_NATIVE_TYPE_JSON, 1, 0, 0, 0, NULL, &json->var, &data) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+    if (dpiJson_setValue(data->value.asJson, top_node) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+    RBORADB_SET(json, dpiJson, data->value.asJson, dconn);
+    return obj;
 }
 
-void rboradb_ruby2dpiJson(VALUE obj, dpiJson *handle, rbOraDBConn *dconn)
+VALUE rboradb_dpiJson2ruby(dpiJson *handle, rbOraDBConn *dconn, int flags)
 {
-    VALUE gc_guard = rb_ary_new();
+    dpiJsonNode *top_node;
+
+    if (dpiJson_getValue(handle, DPI_JSON_OPT_NUMBER_AS_STRING, &top_node) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+    if (flags & RBORADB_JSON_TEXT) {
+        VALUE buf = rb_enc_str_new(NULL, 0, rb_utf8_encoding());
+
+        json_to_text(top_node, buf);
+        return buf;
+    }
+    return json_to_ruby(top_node, flags);
+}
+
+static VALUE json_encode(VALUE arg)
+{
+    json_encoder_t *enc = (json_encoder_t *)arg;
     dpiJsonNode top_node;
     dpiDataBuffer buf;
     top_node.value = &buf;
 
-    ruby_to_json(&top_node, obj, gc_guard);
-    if (dpiJson_setValue(handle, &top_node) != DPI_SUCCESS) {
-        rboradb_raise_error(dconn->ctxt);
+    ruby_to_json(enc, &top_node, enc->obj);
+    if (dpiJson_setValue(enc->handle, &top_node) != DPI_SUCCESS) {
+        rboradb_raise_error(enc->dconn->ctxt);
+    }
+    return Qnil;
+}
+
+static VALUE json_encoder_free(VALUE arg)
+{
+    arena_free((json_encoder_t *)arg);
+    return Qnil;
+}
+
+void rboradb_ruby2dpiJson(VALUE obj, dpiJson *handle, rbOraDBConn *dconn)
+{
+    json_encoder_t enc = {NULL, Qnil, obj, handle, dconn};
+    size_t size = arena_size(obj);
+
+    if (size > 0) {
+        arena_add_block(&enc, size);
+    }
+    rb_ensure(json_encode, (VALUE)&enc, json_encoder_free, (VALUE)&enc);
+    RB_GC_GUARD(enc.gc_guard);
+    RB_GC_GUARD(obj);
+}
+
+void rboradb_text2dpiJson(VALUE text, dpiJson *handle, rbOraDBConn *dconn)
+{
+    json_parser_t parser = {{NULL, Qnil, Qnil, handle, dconn},};
+    size_t size;
+
+    ExportString(text);
+    // The parsed tree may refer to the text until dpiJson_setValue().
+    text = rb_str_new_frozen(text);
+    if (rb_enc_str_coderange(text) == ENC_CODERANGE_BROKEN) {
+        rb_raise(rb_eArgError, "invalid byte sequence in JSON text");
     }
-    RB_GC_GUARD(gc_guard);
+    parser.enc.obj = text;
+    parser.start = parser.ptr = RSTRING_PTR(text);
+    parser.end = parser.ptr + RSTRING_LEN(text);
+    size = RSTRING_LEN(text) * 2;
+    arena_add_block(&parser.enc, size > ARENA_MIN_BLOCK_SIZE ? size : ARENA_MIN_BLOCK_SIZE);
+    rb_ensure(json_parse, (VALUE)&parser, json_parser_free, (VALUE)&parser);
+    RB_GC_GUARD(text);
 }
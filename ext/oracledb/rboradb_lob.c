@@ -13,6 +13,14 @@
 // (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
 //-----------------------------------------------------------------------------
 #include "rboradb.h"
+#include "ruby/io.h"
+#include "ruby/thread.h"
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <errno.h>
 
 #define To_Lob(obj) ((Lob_t *)rb_check_typeddata((obj), &lob_data_type))
 
@@ -24,23 +32,33 @@ static VALUE cLob;
 typedef struct {
     RBORADB_COMMON_HEADER(dpiLob);
     dpiOracleTypeNum type;
+    uint32_t chunk_size; // cached. 0 if not retrieved yet.
+    uint64_t bytes_per_char; // cached. 0 if not retrieved yet.
 } Lob_t;
 
 static VALUE lob_alloc(VALUE klass);
 static void lob_free(void *arg);
 
-static size_t get_size_in_chars(VALUE s)
+typedef struct {
+    int fd;
+    char *ptr;
+    long len;
+    long rv;
+    int err;
+} fd_io_t;
+
+// Returns the size in UCS-2 code points or -1 for invalid UTF-8.
+// This may be called without GVL.
+static long utf8_size_in_chars(const uint8_t *ptr, const uint8_t *end)
 {
-    const uint8_t *ptr = (const uint8_t *)RSTRING_PTR(s);
-    const uint8_t *end = (const uint8_t *)RSTRING_END(s);
-    size_t size = 0;
+    long size = 0;
 
     while (ptr < end) {
         if (*ptr < 0x80) {
             size++;
             ptr++;
         } else if (*ptr < 0xC2) {
-            rb_raise(rb_eEncodingError, "Invalid UTF-8 encoding");
+            return -1;
         } else if (*ptr < 0xE0) {
             size++;
             ptr += 2;
@@ -53,17 +71,83 @@ static size_t get_size_in_chars(VALUE s)
             size += 2;
             ptr += 4;
         } else {
-            rb_raise(rb_eEncodingError, "Invalid UTF-8 encoding");
+            return -1;
         }
     }
+    return size;
+}
+
+static size_t get_size_in_chars(VALUE s)
+{
+    long size = utf8_size_in_chars((const uint8_t *)RSTRING_PTR(s), (const uint8_t *)RSTRING_END(s));
+
+    if (size < 0) {
+        rb_raise(rb_eEncodingError, "Invalid UTF-8 encoding");
+    }
     RB_GC_GUARD(s);
     return size;
 }
 
+// Returns the length of the longest prefix without incomplete UTF-8
+// sequence at the end. This may be called without GVL.
+static long utf8_complete_len(const uint8_t *ptr, long len)
+{
+    long idx;
+
+    for (idx = len - 1; idx >= 0 && idx >= len - 4; idx--) {
+        uint8_t c = ptr[idx];
+        long seqlen;
+
+        if (c < 0x80) {
+            return len;
+        }
+        if (c < 0xC0) {
+            continue; // trailing byte
+        }
+        seqlen = (c < 0xE0) ? 2 : (c < 0xF0) ? 3 : 4;
+        return (idx + seqlen <= len) ? len : idx;
+    }
+    return len;
+}
+
+static uint64_t get_buffer_size(Lob_t *lob, uint64_t char_size)
+{
+    if (lob->bytes_per_char == 0) {
+        if (dpiLob_getBufferSize(lob->handle, 1, &lob->bytes_per_char) != DPI_SUCCESS) {
+            RBORADB_RAISE_ERROR(lob);
+        }
+    }
+    return char_size * lob->bytes_per_char;
+}
+
+static size_t write_bytes(Lob_t *lob, uint64_t offset, VALUE value)
+{
+    size_t size;
+    int rv;
+
+    if (CHAR_TYPE(lob->type)) {
+        size = get_size_in_chars(value);
+    } else {
+        size = RSTRING_LEN(value);
+    }
+    rb_str_locktmp(value);
+    rv = rbOraDBLob_writeBytes(lob->dconn, lob->handle, offset, RSTRING_PTR(value), RSTRING_LEN(value));
+    rb_str_unlocktmp(value);
+    if (rv != DPI_SUCCESS) {
+        RBORADB_RAISE_ERROR(lob);
+    }
+    return size;
+}
+
+static size_t lob_memsize(const void *arg)
+{
+    return sizeof(Lob_t);
+}
+
 static const struct rb_data_type_struct lob_data_type = {
     "OracleDB::Lob",
-    {NULL, lob_free,},
-    NULL, NULL,
+    {NULL, lob_free, lob_memsize,},
+    NULL, NULL, RBORADB_TYPED_DEFERRED_FLAGS,
 };
 
 static VALUE lob_alloc(VALUE klass)
@@ -83,10 +167,10 @@ static VALUE lob___initialize(VALUE self, VALUE conn, VALUE type)
 {
     Lob_t *lob = To_Lob(self);
     rbOraDBConn *dconn = rboradb_get_dconn_in_conn(conn);
-    dpiOracleTypeNum lobtype = rboradb_from_dpiOracleTypeNum(type);
+    dpiOracleTypeNum lobtype = rboradb_to_dpiOracleTypeNum(type);
 
-    if (rbOraDBConn_newTempLob(dconn->handle, lobtype, &lob->handle) != DPI_SUCCESS) {
-        rboradb_raise_error(dconn->ctxt);
+    if (rbOraDBConn_newTempLob(dconn, lobtype, &lob->handle) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(dconn);
     }
     RBORADB_INIT(lob, dconn);
     lob->type = lobtype;
@@ -131,7 +215,14 @@ static VALUE lob_close_resource(VALUE self)
 
 static VALUE lob_chunk_size(VALUE self)
 {
-    GET_UINT32(Lob, ChunkSize);
+    Lob_t *lob = To_Lob(self);
+
+    if (lob->chunk_size == 0) {
+        if (dpiLob_getChunkSize(lob->handle, &lob->chunk_size) != DPI_SUCCESS) {
+            RBORADB_RAISE_ERROR(lob);
+        }
+    }
+    return UINT2NUM(lob->chunk_size);
 }
 
 static VALUE lob_directory_and_file_name(VALUE self)
@@ -176,23 +267,32 @@ static VALUE lob_open_resource(VALUE self)
     return Qnil;
 }
 
-static VALUE lob___read_bytes(VALUE self, VALUE offset, VALUE amount)
+static VALUE lob___read_bytes(VALUE self, VALUE offset, VALUE amount, VALUE outbuf)
 {
     Lob_t *lob = To_Lob(self);
     uint64_t off = NUM2ULL(offset);
     uint64_t char_size = NUM2ULL(amount);
-    uint64_t byte_size;
+    uint64_t byte_size = get_buffer_size(lob, char_size);
     size_t size;
     VALUE str;
+    int rv;
 
-    if (dpiLob_getBufferSize(lob->handle, char_size, &byte_size) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(lob);
-    }
     if (byte_size > (uint64_t)LONG_MAX) {
         rb_raise(rb_eArgError, "size too big");
     }
-    str = rb_str_buf_new(byte_size);
-    if (dpiLob_readBytes(lob->handle, off, char_size, RSTRING_PTR(str), &byte_size) != DPI_SUCCESS) {
+    if (NIL_P(outbuf)) {
+        str = rb_str_buf_new(byte_size);
+    } else {
+        str = outbuf;
+        StringValue(str);
+        rb_str_modify(str);
+        rb_str_set_len(str, 0);
+        rb_str_modify_expand(str, byte_size);
+    }
+    rb_str_locktmp(str);
+    rv = rbOraDBLob_readBytes(lob->dconn, lob->handle, off, char_size, RSTRING_PTR(str), &byte_size);
+    rb_str_unlocktmp(str);
+    if (rv != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(lob);
     }
     rb_str_set_len(str, byte_size);
@@ -200,11 +300,190 @@ static VALUE lob___read_bytes(VALUE self, VALUE offset, VALUE amount)
         rb_enc_associate(str, rb_utf8_encoding());
         size = get_size_in_chars(str);
     } else {
+        rb_enc_associate(str, rb_ascii8bit_encoding());
         size = RSTRING_LEN(str);
     }
     return rb_ary_new_from_args(2, str, SIZET2NUM(size));
 }
 
+static void *fd_read_cb(void *data)
+{
+    fd_io_t *arg = (fd_io_t *)data;
+
+    arg->rv = read(arg->fd, arg->ptr, arg->len);
+    arg->err = errno;
+    return NULL;
+}
+
+static void *fd_write_cb(void *data)
+{
+    fd_io_t *arg = (fd_io_t *)data;
+
+    arg->rv = write(arg->fd, arg->ptr, arg->len);
+    arg->err = errno;
+    return NULL;
+}
+
+// Reads or writes a file descriptor without GVL and returns the number of
+// bytes. It waits for the descriptor in non-blocking mode, such as
+// sockets and pipes, to become ready.
+static long fd_io(int fd, char *ptr, long len, int to_fd)
+{
+    fd_io_t arg;
+
+    arg.fd = fd;
+    arg.ptr = ptr;
+    arg.len = len;
+    while (1) {
+        rb_thread_call_without_gvl(to_fd ? fd_write_cb : fd_read_cb, &arg, RUBY_UBF_IO, NULL);
+        if (arg.rv >= 0) {
+            return arg.rv;
+        }
+        switch (arg.err) {
+        case EINTR:
+            rb_thread_check_ints();
+            break;
+        case EAGAIN:
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+            if (to_fd) {
+                rb_thread_fd_writable(fd);
+            } else {
+                rb_thread_wait_fd(fd);
+            }
+            break;
+        default:
+            rb_syserr_fail(arg.err, NULL);
+        }
+    }
+}
+
+static uint64_t copy_to_fd(Lob_t *lob, int fd, uint64_t offset, uint64_t amount, char *buf, uint64_t buf_size)
+{
+    uint64_t size = 0;
+
+    while (1) {
+        uint64_t len = buf_size;
+        char *ptr = buf;
+
+        if (rbOraDBLob_readBytes(lob->dconn, lob->handle, offset + size, amount, buf, &len) != DPI_SUCCESS) {
+            RBORADB_RAISE_ERROR(lob);
+        }
+        if (len == 0) {
+            break;
+        }
+        if (CHAR_TYPE(lob->type)) {
+            long n = utf8_size_in_chars((const uint8_t *)buf, (const uint8_t *)buf + len);
+            if (n < 0) {
+                rb_raise(rb_eEncodingError, "Invalid UTF-8 encoding");
+            }
+            size += n;
+        } else {
+            size += len;
+        }
+        while (len > 0) {
+            long n = fd_io(fd, ptr, (long)len, 1);
+            ptr += n;
+            len -= n;
+        }
+    }
+    return size;
+}
+
+static uint64_t copy_from_fd(Lob_t *lob, int fd, uint64_t offset, char *buf, uint64_t buf_size)
+{
+    uint64_t size = 0;
+    long rest = 0;
+
+    while (1) {
+        long len = fd_io(fd, buf + rest, (long)buf_size - rest, 0);
+        long wlen, n;
+
+        if (len == 0) {
+            if (rest != 0) {
+                rb_raise(rb_eEncodingError, "incomplete UTF-8 sequence at the end of the stream");
+            }
+            break;
+        }
+        len += rest;
+        wlen = CHAR_TYPE(lob->type) ? utf8_complete_len((const uint8_t *)buf, len) : len;
+        if (wlen > 0) {
+            if (CHAR_TYPE(lob->type)) {
+                n = utf8_size_in_chars((const uint8_t *)buf, (const uint8_t *)buf + wlen);
+                if (n < 0) {
+                    rb_raise(rb_eEncodingError, "Invalid UTF-8 encoding");
+                }
+            } else {
+                n = wlen;
+            }
+            if (rbOraDBLob_writeBytes(lob->dconn, lob->handle, offset + size, buf, wlen) != DPI_SUCCESS) {
+                RBORADB_RAISE_ERROR(lob);
+            }
+            size += n;
+        }
+        rest = len - wlen;
+        memmove(buf, buf + wlen, rest);
+    }
+    return size;
+}
+
+// Copies data between a LOB and a file descriptor through one native
+// buffer. Returns the copied size or nil when +io+ has data buffered in
+// ruby. Data of CLOBs are passed as UTF-8 bytes.
+static VALUE fd_copy(VALUE self, VALUE io, VALUE offset, VALUE amount, int to_fd)
+{
+    Lob_t *lob = To_Lob(self);
+    rb_io_t *fptr;
+    uint64_t buf_size, size;
+    char *buf;
+    VALUE tmp;
+    int fd;
+
+    io = rb_io_get_io(io);
+    if (to_fd) {
+        rb_io_flush(io);
+    }
+    GetOpenFile(io, fptr);
+    if (to_fd) {
+        rb_io_check_writable(fptr);
+    } else {
+        rb_io_check_char_readable(fptr);
+        if (rb_io_read_pending(fptr)) {
+            return Qnil;
+        }
+    }
+#ifdef HAVE_RB_IO_DESCRIPTOR
+    fd = rb_io_descriptor(io);
+#else
+    fd = fptr->fd;
+#endif
+    buf_size = to_fd ? get_buffer_size(lob, NUM2ULL(amount)) : NUM2ULL(amount);
+    if (buf_size > (uint64_t)LONG_MAX || buf_size < 4) {
+        rb_raise(rb_eArgError, "invalid buffer size");
+    }
+    // The buffer is freed by GC when an exception is raised.
+    buf = RB_ALLOCV_N(char, tmp, buf_size);
+    if (to_fd) {
+        size = copy_to_fd(lob, fd, NUM2ULL(offset), NUM2ULL(amount), buf, buf_size);
+    } else {
+        size = copy_from_fd(lob, fd, NUM2ULL(offset), buf, buf_size);
+    }
+    RB_ALLOCV_END(tmp);
+    RB_GC_GUARD(io);
+    return ULL2NUM(size);
+}
+
+static VALUE lob___copy_to_io(VALUE self, VALUE io, VALUE offset, VALUE amount)
+{
+    return fd_copy(self, io, offset, amount, 1);
+}
+
+static VALUE lob___copy_from_io(VALUE self, VALUE io, VALUE offset, VALUE amount)
+{
+    return fd_copy(self, io, offset, amount, 0);
+}
+
 static VALUE lob_set_directory_and_file_name(VALUE self, VALUE directory_alias, VALUE file_name)
 {
     Lob_t *lob = To_Lob(self);
@@ -234,7 +513,7 @@ static VALUE lob___set_from_bytes(VALUE self, VALUE value)
 
     SafeStringValue(value);
     if (CHAR_TYPE(lob->type)) {
-        value = rb_str_export_to_enc(value, rb_utf8_encoding());
+        value = rboradb_export_utf8(value);
         size = get_size_in_chars(value);
     } else {
         size = RSTRING_LEN(value);
@@ -248,20 +527,32 @@ static VALUE lob___set_from_bytes(VALUE self, VALUE value)
 static VALUE lob___write_bytes(VALUE self, VALUE offset, VALUE value)
 {
     Lob_t *lob = To_Lob(self);
-    uint64_t off = NUM2ULL(offset);
-    size_t size;
 
     SafeStringValue(value);
     if (CHAR_TYPE(lob->type)) {
-        value = rb_str_export_to_enc(value, rb_utf8_encoding());
-        size = get_size_in_chars(value);
-    } else {
-        size = RSTRING_LEN(value);
+        value = rboradb_export_utf8(value);
     }
-    if (dpiLob_writeBytes(lob->handle, off, RSTRING_PTR(value), RSTRING_LEN(value)) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(lob);
+    return SIZET2NUM(write_bytes(lob, NUM2ULL(offset), value));
+}
+
+// Writes bytes in UTF-8 for CLOBs without incomplete UTF-8 sequence
+// at the end. Returns the written size and the number of written bytes.
+static VALUE lob___write_partial(VALUE self, VALUE offset, VALUE value)
+{
+    Lob_t *lob = To_Lob(self);
+    long len;
+    size_t size;
+
+    SafeStringValue(value);
+    len = RSTRING_LEN(value);
+    if (CHAR_TYPE(lob->type)) {
+        len = utf8_complete_len((const uint8_t *)RSTRING_PTR(value), len);
+        if (len != RSTRING_LEN(value)) {
+            value = rb_str_subseq(value, 0, len);
+        }
     }
-    return SIZET2NUM(size);
+    size = write_bytes(lob, NUM2ULL(offset), value);
+    return rb_ary_new_from_args(2, SIZET2NUM(size), LONG2NUM(len));
 }
 
 void rboradb_lob_init(VALUE mOracleDB)
@@ -281,11 +572,14 @@ void rboradb_lob_init(VALUE mOracleDB)
     rb_define_method(cLob, "size", lob_size, 0);
     rb_define_method(cLob, "type", lob_type, 0);
     rb_define_method(cLob, "open_resource", lob_open_resource, 0);
-    rb_define_private_method(cLob, "__read_bytes", lob___read_bytes, 2);
+    rb_define_private_method(cLob, "__read_bytes", lob___read_bytes, 3);
+    rb_define_private_method(cLob, "__copy_to_io", lob___copy_to_io, 3);
+    rb_define_private_method(cLob, "__copy_from_io", lob___copy_from_io, 3);
     rb_define_method(cLob, "set_directory_and_file_name", lob_set_directory_and_file_name, 2);
     rb_define_method(cLob, "trim", lob_trim, 1);
     rb_define_private_method(cLob, "__set_from_bytes", lob___set_from_bytes, 1);
     rb_define_private_method(cLob, "__write_bytes", lob___write_bytes, 2);
+    rb_define_private_method(cLob, "__write_partial", lob___write_partial, 2);
 }
 
 VALUE rboradb_from_dpiLob(dpiLob *handle, rbOraDBConn *dconn, int ref)
@@ -18,27 +18,285 @@
 #define To_ObjectType(obj) ((ObjectType_t *)rb_check_typeddata((obj), &object_type_data_type))
 #define To_ObjectAttr(obj) ((ObjectAttr_t *)rb_check_typeddata((obj), &object_attr_data_type))
 
+// Object type metadata cached per connection by dpiObjectType handles.
+// Metadata are reference counted because objects keep them after they
+// are evicted from the cache.
+#define OBJTYPE_CACHE_MAX_ENTRIES 64
+
+// Conversion flags of object_to_ruby()
+#define OBJ_INDEX_HASH 0x01 // collections to hashes keyed by indexes
+#define OBJ_STRUCT 0x02 // objects to instances of ObjectType#ruby_class
+
+typedef struct {
+    dpiOracleTypeNum oracle_type;
+    dpiNativeTypeNum native_type;
+    dpiObjectType *objtype;
+    struct objtype_meta *meta; // metadata of objtype set on first use
+} type_meta_t;
+
+typedef struct {
+    dpiObjectAttr *handle;
+    const char *name;
+    uint32_t name_length;
+    type_meta_t type;
+} attr_meta_t;
+
+typedef struct objtype_meta {
+    rb_atomic_t refcnt;
+    dpiObjectType *handle;
+    const char *schema; // owned by handle
+    uint32_t schema_length;
+    const char *name; // owned by handle
+    uint32_t name_length;
+    VALUE ruby_class; // Qfalse until it is looked up
+    int is_collection;
+    type_meta_t element;
+    uint16_t num_attrs;
+    attr_meta_t attrs[1];
+} objtype_meta_t;
+
 typedef struct {
     RBORADB_COMMON_HEADER(dpiObject);
     dpiObjectType *objtype;
+    objtype_meta_t *meta; // set on first use
 } Object_t;
 
 typedef struct {
     RBORADB_COMMON_HEADER(dpiObjectType);
+    objtype_meta_t *meta; // set on first use
 } ObjectType_t;
 
 typedef struct {
     RBORADB_COMMON_HEADER(dpiObjectAttr);
+    type_meta_t type;
 } ObjectAttr_t;
 
 static VALUE cObject;
 static VALUE cObjectType;
 static VALUE cObjectAttr;
+// Struct classes of object types keyed by qualified type names followed
+// by attribute names such as "SCHEMA.NAME(a,b)". Classes are never freed
+// and pinned by rb_gc_register_mark_object().
+static st_table *struct_classes;
+
+static void set_type_meta(type_meta_t *type, const dpiDataTypeInfo *info)
+{
+    type->oracle_type = info->oracleTypeNum;
+    type->native_type = info->defaultNativeTypeNum;
+    type->objtype = info->objectType;
+    type->meta = NULL;
+    if (type->oracle_type == DPI_ORACLE_TYPE_NUMBER) {
+        type->native_type = DPI_NATIVE_TYPE_BYTES;
+    }
+}
+
+static void objtype_meta_release(objtype_meta_t *meta)
+{
+    if (RUBY_ATOMIC_FETCH_SUB(meta->refcnt, 1) == 1) {
+        uint16_t idx;
+
+        if (meta->element.meta) {
+            objtype_meta_release(meta->element.meta);
+        }
+        for (idx = 0; idx < meta->num_attrs; idx++) {
+            if (meta->attrs[idx].type.meta) {
+                objtype_meta_release(meta->attrs[idx].type.meta);
+            }
+            if (meta->attrs[idx].handle) {
+                dpiObjectAttr_release(meta->attrs[idx].handle);
+            }
+        }
+        dpiObjectType_release(meta->handle);
+        xfree(meta);
+    }
+}
+
+static int release_cache_entry(st_data_t key, st_data_t val, st_data_t arg)
+{
+    objtype_meta_release((objtype_meta_t *)val);
+    return ST_DELETE;
+}
+
+void rboradb_free_objtype_cache(st_table *cache)
+{
+    st_foreach(cache, release_cache_entry, 0);
+    st_free_table(cache);
+}
+
+static objtype_meta_t *new_objtype_meta(dpiObjectType *handle, rbOraDBConn *dconn)
+{
+    dpiObjectTypeInfo info;
+    dpiObjectAttr **attrs;
+    objtype_meta_t *meta;
+    uint16_t idx;
+
+    if (dpiObjectType_getInfo(handle, &info) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+    if (info.isCollection) {
+        info.numAttributes = 0;
+    }
+    meta = (objtype_meta_t *)xcalloc(1, offsetof(objtype_meta_t, attrs) + sizeof(attr_meta_t) * (info.numAttributes + 1));
+    meta->refcnt = 1;
+    meta->handle = handle;
+    dpiObjectType_addRef(handle);
+    meta->schema = info.schema;
+    meta->schema_length = info.schemaLength;
+    meta->name = info.name;
+    meta->name_length = info.nameLength;
+    meta->is_collection = info.isCollection;
+    if (info.isCollection) {
+        set_type_meta(&meta->element, &info.elementTypeInfo);
+        return meta;
+    }
+    attrs = ALLOCA_N(dpiObjectAttr*, info.numAttributes);
+    if (dpiObjectType_getAttributes(handle, info.numAttributes, attrs) != DPI_SUCCESS) {
+        goto error;
+    }
+    meta->num_attrs = info.numAttributes;
+    for (idx = 0; idx < info.numAttributes; idx++) {
+        meta->attrs[idx].handle = attrs[idx];
+    }
+    for (idx = 0; idx < info.numAttributes; idx++) {
+        dpiObjectAttrInfo attr_info;
+
+        if (dpiObjectAttr_getInfo(attrs[idx], &attr_info) != DPI_SUCCESS) {
+            goto error;
+        }
+        // The name is owned by the attribute handle.
+        meta->attrs[idx].name = attr_info.name;
+        meta->attrs[idx].name_length = attr_info.nameLength;
+        set_type_meta(&meta->attrs[idx].type, &attr_info.typeInfo);
+    }
+    return meta;
+error:
+    {
+        dpiErrorInfo error;
+        VALUE exc;
+
+        dpiContext_getError(dconn->ctxt->handle, &error);
+        exc = rboradb_from_dpiErrorInfo(&error);
+        objtype_meta_release(meta);
+        rb_exc_raise(exc);
+    }
+}
+
+// Returns cached metadata of +handle+. The caller must not keep it
+// beyond the next lookup without adding a reference. Use
+// get_objtype_meta() when ruby code may run meanwhile.
+static objtype_meta_t *lookup_objtype_meta(dpiObjectType *handle, rbOraDBConn *dconn)
+{
+    objtype_meta_t *meta;
+    st_data_t val;
+
+    if (dconn->objtype_cache == NULL) {
+        dconn->objtype_cache = st_init_numtable();
+    }
+    if (st_lookup(dconn->objtype_cache, (st_data_t)handle, &val)) {
+        return (objtype_meta_t *)val;
+    }
+    meta = new_objtype_meta(handle, dconn);
+    if (dconn->objtype_cache->num_entries >= OBJTYPE_CACHE_MAX_ENTRIES) {
+        st_foreach(dconn->objtype_cache, release_cache_entry, 0);
+    }
+    st_insert(dconn->objtype_cache, (st_data_t)handle, (st_data_t)meta);
+    return meta;
+}
+
+// Returns cached metadata of +handle+ with a new reference.
+static objtype_meta_t *get_objtype_meta(dpiObjectType *handle, rbOraDBConn *dconn)
+{
+    objtype_meta_t *meta = lookup_objtype_meta(handle, dconn);
+
+    RUBY_ATOMIC_INC(meta->refcnt);
+    return meta;
+}
+
+// Returns the Struct class of object types. Members are attribute names
+// in lower case. Classes are shared by types with the same name and the
+// same attributes. A type altered or of another database with different
+// attributes gets another class.
+static VALUE struct_class(objtype_meta_t *meta)
+{
+    VALUE key = rb_str_buf_new(meta->schema_length + 1 + meta->name_length);
+    st_data_t val;
+    VALUE *members;
+    VALUE klass;
+    uint16_t idx;
+
+    if (meta->ruby_class) {
+        return meta->ruby_class;
+    }
+    rb_str_buf_cat(key, meta->schema, meta->schema_length);
+    rb_str_buf_cat(key, ".", 1);
+    rb_str_buf_cat(key, meta->name, meta->name_length);
+    members = ALLOCA_N(VALUE, meta->num_attrs);
+    for (idx = 0; idx < meta->num_attrs; idx++) {
+        attr_meta_t *attr = &meta->attrs[idx];
+        char name[128]; // the max length of identifiers
+        uint32_t i;
+
+        if (attr->name_length > sizeof(name)) {
+            rb_raise(rb_eRuntimeError, "too long attribute name: %.*s", (int)attr->name_length, attr->name);
+        }
+        for (i = 0; i < attr->name_length; i++) {
+            name[i] = rb_tolower((unsigned char)attr->name[i]);
+        }
+        members[idx] = ID2SYM(rb_intern3(name, attr->name_length, rb_utf8_encoding()));
+        rb_str_buf_cat(key, idx == 0 ? "(" : ",", 1);
+        rb_str_buf_cat(key, name, attr->name_length);
+    }
+    rb_str_buf_cat(key, ")", 1);
+    if (st_lookup(struct_classes, (st_data_t)StringValueCStr(key), &val)) {
+        meta->ruby_class = (VALUE)val;
+        return meta->ruby_class;
+    }
+    klass = rb_funcallv(rb_cStruct, rb_intern("new"), meta->num_attrs, members);
+    // Struct.new may switch threads and another thread may add the class.
+    if (st_lookup(struct_classes, (st_data_t)RSTRING_PTR(key), &val)) {
+        meta->ruby_class = (VALUE)val;
+        return meta->ruby_class;
+    }
+    rb_gc_register_mark_object(klass);
+    st_insert(struct_classes, (st_data_t)memcpy(ALLOC_N(char, RSTRING_LEN(key) + 1), RSTRING_PTR(key), RSTRING_LEN(key) + 1), (st_data_t)klass);
+    meta->ruby_class = klass;
+    RB_GC_GUARD(key);
+    return klass;
+}
+
+// Returns metadata of the object type of elements or attributes. They are
+// owned by the parent metadata and aren't shared with the cache.
+static objtype_meta_t *child_meta(type_meta_t *type, rbOraDBConn *dconn)
+{
+    if (type->meta == NULL) {
+        type->meta = new_objtype_meta(type->objtype, dconn);
+    }
+    return type->meta;
+}
+
+static objtype_meta_t *object_meta(Object_t *obj)
+{
+    if (obj->meta == NULL) {
+        obj->meta = get_objtype_meta(obj->objtype, obj->dconn);
+    }
+    return obj->meta;
+}
+
+static objtype_meta_t *object_type_meta(ObjectType_t *objtype)
+{
+    if (objtype->meta == NULL) {
+        objtype->meta = get_objtype_meta(objtype->handle, objtype->dconn);
+    }
+    return objtype->meta;
+}
 
 static void object_free(void *arg)
 {
     Object_t *obj = (Object_t *)arg;
 
+    if (obj->meta) {
+        objtype_meta_release(obj->meta);
+    }
     if (obj->objtype) {
         dpiObjectType_release(obj->objtype);
     }
@@ -46,67 +304,281 @@ static void object_free(void *arg)
     xfree(arg);
 }
 
+static size_t object_memsize(const void *arg)
+{
+    return sizeof(Object_t);
+}
+
 static const struct rb_data_type_struct object_data_type = {
     "OracleDB::Object",
-    {NULL, object_free,},
-    NULL, NULL,
+    {NULL, object_free, object_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static void object_type_free(void *arg)
 {
     ObjectType_t *objtype = (ObjectType_t *)arg;
 
+    if (objtype->meta) {
+        objtype_meta_release(objtype->meta);
+    }
     RBORADB_RELEASE(objtype, dpiObjectType);
     xfree(arg);
 }
 
+static size_t object_type_memsize(const void *arg)
+{
+    return sizeof(ObjectType_t);
+}
+
 static const struct rb_data_type_struct object_type_data_type = {
     "OracleDB::ObjectType",
-    {NULL, object_type_free,},
-    NULL, NULL,
+    {NULL, object_type_free, object_type_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static void object_attr_free(void *arg)
 {
     ObjectAttr_t *objattr = (ObjectAttr_t *)arg;
 
+    if (objattr->type.meta) {
+        objtype_meta_release(objattr->type.meta);
+    }
     RBORADB_RELEASE(objattr, dpiObjectAttr);
     xfree(arg);
 }
 
+static size_t object_attr_memsize(const void *arg)
+{
+    return sizeof(ObjectAttr_t);
+}
+
 static const struct rb_data_type_struct object_attr_data_type = {
     "OracleDB::ObjectAttr",
-    {NULL, object_attr_free,},
-    NULL, NULL,
+    {NULL, object_attr_free, object_attr_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
-static VALUE set_element_value(dpiData *data, dpiNativeTypeNum *native_type, dpiObjectType *objtype, rbOraDBConn *dconn, VALUE value, _Bool expect_collection)
+static void check_collection(objtype_meta_t *meta, int expect_collection)
 {
-    dpiObjectTypeInfo info;
-    dpiOracleTypeNum oracle_type;
-
-    if (dpiObjectType_getInfo(objtype, &info) != DPI_SUCCESS) {
-        rboradb_raise_error(dconn->ctxt);
-    }
     if (expect_collection) {
-        if (!info.isCollection) {
+        if (!meta->is_collection) {
             rb_raise(rb_eArgError, "self isn't a collection.");
         }
     } else {
-        if (info.isCollection) {
+        if (meta->is_collection) {
             rb_raise(rb_eArgError, "self is a collection.");
         }
     }
+}
+
+static VALUE new_object_from(objtype_meta_t *meta, VALUE value, rbOraDBConn *dconn);
+
+// Sets +value+ to +data+. Arrays, hashes and structs are converted to
+// objects when the type is an object type.
+static VALUE set_element_value(dpiData *data, type_meta_t *type, rbOraDBConn *dconn, VALUE value)
+{
     if (NIL_P(value)) {
         data->isNull = 1;
         return Qnil;
     }
-    oracle_type = info.elementTypeInfo.oracleTypeNum;
-    *native_type = info.elementTypeInfo.defaultNativeTypeNum;
-    if (oracle_type == DPI_ORACLE_TYPE_NUMBER) {
-        *native_type = DPI_NATIVE_TYPE_BYTES;
+    if (type->native_type == DPI_NATIVE_TYPE_OBJECT) {
+        if (RB_TYPE_P(value, T_ARRAY) || RB_TYPE_P(value, T_HASH) || RB_TYPE_P(value, T_STRUCT)) {
+            value = new_object_from(child_meta(type, dconn), value, dconn);
+        }
+        rboradb_set_data(value, data, type->native_type, type->oracle_type, dconn, NULL, 0);
+        return value;
+    }
+    return rboradb_set_data(value, data, type->native_type, type->oracle_type, dconn, NULL, 0);
+}
+
+static VALUE object_to_ruby(dpiObject *handle, objtype_meta_t *meta, rbOraDBConn *dconn, int flags);
+
+// Converts +data+ to a ruby value. Objects are converted to arrays,
+// hashes or structs without creating OracleDB::Object.
+static VALUE element_to_ruby(dpiData *data, type_meta_t *type, rbOraDBConn *dconn, int flags)
+{
+    if (data->isNull) {
+        return Qnil;
+    }
+    if (type->native_type == DPI_NATIVE_TYPE_OBJECT) {
+        return object_to_ruby(data->value.asObject, child_meta(type, dconn), dconn, flags & OBJ_STRUCT);
     }
-    return rboradb_set_data(value, data, *native_type, oracle_type, dconn, NULL, 0);
+    return rboradb_from_data(data, type->native_type, type->oracle_type, type->objtype, Qnil, dconn);
+}
+
+// Converts collections to arrays, or hashes keyed by indexes with
+// OBJ_INDEX_HASH, and other objects to hashes keyed by attribute names,
+// or structs with OBJ_STRUCT.
+static VALUE object_to_ruby(dpiObject *handle, objtype_meta_t *meta, rbOraDBConn *dconn, int flags)
+{
+    int as_hash = flags & OBJ_INDEX_HASH;
+    dpiData data;
+    VALUE result;
+
+    if (meta->is_collection) {
+        int32_t idx;
+        int exists;
+
+        result = as_hash ? rb_hash_new() : rb_ary_new();
+        if (dpiObject_getFirstIndex(handle, &idx, &exists) != DPI_SUCCESS) {
+            rboradb_raise_conn_error(dconn);
+        }
+        while (exists) {
+            VALUE val;
+
+            if (dpiObject_getElementValueByIndex(handle, idx, meta->element.native_type, &data) != DPI_SUCCESS) {
+                rboradb_raise_conn_error(dconn);
+            }
+            val = element_to_ruby(&data, &meta->element, dconn, flags);
+            if (as_hash) {
+                rb_hash_aset(result, INT2NUM(idx), val);
+            } else {
+                rb_ary_push(result, val);
+            }
+            if (dpiObject_getNextIndex(handle, idx, &idx, &exists) != DPI_SUCCESS) {
+                rboradb_raise_conn_error(dconn);
+            }
+        }
+    } else if (flags & OBJ_STRUCT) {
+        VALUE klass = struct_class(meta);
+        VALUE values = rb_ary_new_capa(meta->num_attrs);
+        uint16_t idx;
+
+        for (idx = 0; idx < meta->num_attrs; idx++) {
+            attr_meta_t *attr = &meta->attrs[idx];
+
+            if (dpiObject_getAttributeValue(handle, attr->handle, attr->type.native_type, &data) != DPI_SUCCESS) {
+                rboradb_raise_conn_error(dconn);
+            }
+            rb_ary_push(values, element_to_ruby(&data, &attr->type, dconn, flags));
+        }
+        result = rb_class_new_instance(RARRAY_LENINT(values), RARRAY_CONST_PTR(values), klass);
+        RB_GC_GUARD(values);
+    } else {
+        uint16_t idx;
+
+#ifdef HAVE_RB_HASH_NEW_CAPA
+        result = rb_hash_new_capa(meta->num_attrs);
+#else
+        result = rb_hash_new();
+#endif
+        for (idx = 0; idx < meta->num_attrs; idx++) {
+            attr_meta_t *attr = &meta->attrs[idx];
+
+            if (dpiObject_getAttributeValue(handle, attr->handle, attr->type.native_type, &data) != DPI_SUCCESS) {
+                rboradb_raise_conn_error(dconn);
+            }
+            rb_hash_aset(result, rb_enc_interned_str(attr->name, attr->name_length, rb_utf8_encoding()),
+                element_to_ruby(&data, &attr->type, dconn, flags));
+        }
+    }
+    return result;
+}
+
+static attr_meta_t *find_attr(objtype_meta_t *meta, VALUE key)
+{
+    uint16_t idx;
+
+    if (RB_SYMBOL_P(key)) {
+        key = rb_sym2str(key);
+    }
+    StringValue(key);
+    for (idx = 0; idx < meta->num_attrs; idx++) {
+        attr_meta_t *attr = &meta->attrs[idx];
+
+        if (attr->name_length == RSTRING_LEN(key) && rb_memcicmp(attr->name, RSTRING_PTR(key), attr->name_length) == 0) {
+            return attr;
+        }
+    }
+    rb_raise(rb_eArgError, "unknown attribute: %"PRIsVALUE, key);
+}
+
+typedef struct {
+    dpiObject *handle;
+    objtype_meta_t *meta;
+    rbOraDBConn *dconn;
+} set_attr_arg_t;
+
+static int set_attr_i(VALUE key, VALUE value, VALUE arg)
+{
+    set_attr_arg_t *sa = (set_attr_arg_t *)arg;
+    attr_meta_t *attr = find_attr(sa->meta, key);
+    dpiData data = {1,};
+    VALUE gc_guard = set_element_value(&data, &attr->type, sa->dconn, value);
+
+    if (dpiObject_setAttributeValue(sa->handle, attr->handle, attr->type.native_type, &data) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(sa->dconn);
+    }
+    RB_GC_GUARD(gc_guard);
+    return ST_CONTINUE;
+}
+
+// Creates an object from an array for collections or from a hash or a
+// struct for other object types.
+static VALUE new_object_from(objtype_meta_t *meta, VALUE value, rbOraDBConn *dconn)
+{
+    dpiObject *handle;
+    VALUE obj;
+    Object_t *object;
+
+    if (meta->is_collection) {
+        value = rb_convert_type(value, T_ARRAY, "Array", "to_ary");
+    } else if (!RB_TYPE_P(value, T_STRUCT)) {
+        value = rb_convert_type(value, T_HASH, "Hash", "to_hash");
+    }
+    if (dpiObjectType_createObject(meta->handle, &handle) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(dconn);
+    }
+    obj = rboradb_from_dpiObject(handle, meta->handle, dconn, 0);
+    object = To_Object(obj);
+    object->meta = meta;
+    RUBY_ATOMIC_INC(meta->refcnt);
+
+    if (meta->is_collection) {
+        long idx;
+
+        for (idx = 0; idx < RARRAY_LEN(value); idx++) {
+            dpiData data = {1,};
+            VALUE gc_guard = set_element_value(&data, &meta->element, dconn, RARRAY_AREF(value, idx));
+
+            if (dpiObject_appendElement(handle, meta->element.native_type, &data) != DPI_SUCCESS) {
+                rboradb_raise_conn_error(dconn);
+            }
+            RB_GC_GUARD(gc_guard);
+        }
+    } else {
+        set_attr_arg_t arg;
+
+        arg.handle = handle;
+        arg.meta = meta;
+        arg.dconn = dconn;
+        if (RB_TYPE_P(value, T_HASH)) {
+            rb_hash_foreach(value, set_attr_i, (VALUE)&arg);
+        } else if (rb_obj_class(value) == meta->ruby_class) {
+            // members are attributes in order.
+            uint16_t idx;
+
+            for (idx = 0; idx < meta->num_attrs; idx++) {
+                attr_meta_t *attr = &meta->attrs[idx];
+                dpiData data = {1,};
+                VALUE gc_guard = set_element_value(&data, &attr->type, dconn, RSTRUCT_GET(value, idx));
+
+                if (dpiObject_setAttributeValue(handle, attr->handle, attr->type.native_type, &data) != DPI_SUCCESS) {
+                    rboradb_raise_conn_error(dconn);
+                }
+                RB_GC_GUARD(gc_guard);
+            }
+        } else {
+            VALUE members = rb_struct_members(value);
+            long idx;
+
+            for (idx = 0; idx < RARRAY_LEN(members); idx++) {
+                set_attr_i(RARRAY_AREF(members, idx), RSTRUCT_GET(value, idx), (VALUE)&arg);
+            }
+        }
+    }
+    return obj;
 }
 
 static VALUE object_alloc(VALUE klass)
@@ -136,22 +608,33 @@ static VALUE object_initialize_copy(VALUE self, VALUE obj)
     Object_t *obj_obj = To_Object(obj);
 
     RBORADB_RELEASE(obj_self, dpiObject);
+    if (obj_self->objtype) {
+        dpiObjectType_release(obj_self->objtype);
+        obj_self->objtype = NULL;
+    }
+    if (obj_self->meta) {
+        objtype_meta_release(obj_self->meta);
+        obj_self->meta = NULL;
+    }
     RBORADB_INIT(obj_self, obj_obj->dconn);
     if (dpiObject_copy(obj_obj->handle, &obj_self->handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj_obj);
     }
     obj_self->objtype = obj_obj->objtype;
+    dpiObjectType_addRef(obj_self->objtype);
     return Qnil;
 }
 
 static VALUE object_append_element(VALUE self, VALUE value)
 {
     Object_t *obj = To_Object(self);
+    objtype_meta_t *meta = object_meta(obj);
     dpiData data = {1,};
-    dpiNativeTypeNum native_type;
-    VALUE gc_guard = set_element_value(&data, &native_type, obj->objtype, obj->dconn, value, true);
+    VALUE gc_guard;
 
-    if (dpiObject_appendElement(obj->handle, native_type, &data) != DPI_SUCCESS) {
+    check_collection(meta, true);
+    gc_guard = set_element_value(&data, &meta->element, obj->dconn, value);
+    if (dpiObject_appendElement(obj->handle, meta->element.native_type, &data) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj);
     }
     RB_GC_GUARD(gc_guard);
@@ -162,26 +645,12 @@ static VALUE object_attribute_value(VALUE self, VALUE attr_type)
 {
     Object_t *obj = To_Object(self);
     ObjectAttr_t *attr = To_ObjectAttr(attr_type);
-    dpiObjectAttrInfo info;
-    dpiOracleTypeNum oracle_type;
-    dpiNativeTypeNum native_type;
-    dpiObjectType *objtype;
     dpiData value;
 
-    if (dpiObjectAttr_getInfo(attr->handle, &info) != DPI_SUCCESS) {
+    if (dpiObject_getAttributeValue(obj->handle, attr->handle, attr->type.native_type, &value) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj);
     }
-    oracle_type = info.typeInfo.oracleTypeNum;
-    native_type = info.typeInfo.defaultNativeTypeNum;
-    objtype = info.typeInfo.objectType;
-
-    if (oracle_type == DPI_ORACLE_TYPE_NUMBER) {
-        native_type = DPI_NATIVE_TYPE_BYTES;
-    }
-    if (dpiObject_getAttributeValue(obj->handle, attr->handle, native_type, &value) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(obj);
-    }
-    return rboradb_from_data(&value, native_type, oracle_type, objtype, Qnil, obj->dconn);
+    return rboradb_from_data(&value, attr->type.native_type, attr->type.oracle_type, attr->type.objtype, Qnil, obj->dconn);
 }
 
 static VALUE object_delete_element_by_index(VALUE self, VALUE index)
@@ -208,28 +677,14 @@ static VALUE object_element_exists_by_index(VALUE self, VALUE index)
 static VALUE object_element_value_by_index(VALUE self, VALUE index)
 {
     Object_t *obj = To_Object(self);
-    dpiObjectTypeInfo info;
-    dpiOracleTypeNum oracle_type;
-    dpiNativeTypeNum native_type;
-    dpiObjectType *objtype;
+    objtype_meta_t *meta = object_meta(obj);
     dpiData value;
 
-    if (dpiObjectType_getInfo(obj->objtype, &info) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(obj);
-    }
-    if (!info.isCollection) {
-        rb_raise(rb_eArgError, "self isn't a collection.");
-    }
-    oracle_type = info.elementTypeInfo.oracleTypeNum;
-    native_type = info.elementTypeInfo.defaultNativeTypeNum;
-    objtype = info.elementTypeInfo.objectType;
-    if (oracle_type == DPI_ORACLE_TYPE_NUMBER) {
-        native_type = DPI_NATIVE_TYPE_BYTES;
-    }
-    if (dpiObject_getElementValueByIndex(obj->handle, NUM2INT(index), native_type, &value) != DPI_SUCCESS) {
+    check_collection(meta, true);
+    if (dpiObject_getElementValueByIndex(obj->handle, NUM2INT(index), meta->element.native_type, &value) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj);
     }
-    return rboradb_from_data(&value, native_type, oracle_type, objtype, Qnil, obj->dconn);
+    return rboradb_from_data(&value, meta->element.native_type, meta->element.oracle_type, meta->element.objtype, Qnil, obj->dconn);
 }
 
 static VALUE object_first_index(VALUE self)
@@ -284,16 +739,10 @@ static VALUE object_set_attribute_value(VALUE self, VALUE attr_type, VALUE value
 {
     Object_t *obj = To_Object(self);
     ObjectAttr_t *attr = To_ObjectAttr(attr_type);
-    dpiObjectAttrInfo info;
     dpiData data = {1,};
-    dpiNativeTypeNum native_type;
-    VALUE gc_guard;
+    VALUE gc_guard = set_element_value(&data, &attr->type, obj->dconn, value);
 
-    if (dpiObjectAttr_getInfo(attr->handle, &info) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(attr);
-    }
-    gc_guard = set_element_value(&data, &native_type, info.typeInfo.objectType, obj->dconn, value, false);
-    if (dpiObject_setAttributeValue(obj->handle, attr->handle, native_type, &data) != DPI_SUCCESS) {
+    if (dpiObject_setAttributeValue(obj->handle, attr->handle, attr->type.native_type, &data) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj);
     }
     RB_GC_GUARD(gc_guard);
@@ -303,18 +752,43 @@ static VALUE object_set_attribute_value(VALUE self, VALUE attr_type, VALUE value
 static VALUE object_set_element_value_by_index(VALUE self, VALUE index, VALUE value)
 {
     Object_t *obj = To_Object(self);
+    objtype_meta_t *meta = object_meta(obj);
     int32_t idx = NUM2INT(index);
     dpiData data = {1,};
-    dpiNativeTypeNum native_type;
-    VALUE gc_guard = set_element_value(&data, &native_type, obj->objtype, obj->dconn, value, true);
+    VALUE gc_guard;
 
-    if (dpiObject_setElementValueByIndex(obj->handle, idx, native_type, &data) != DPI_SUCCESS) {
+    check_collection(meta, true);
+    gc_guard = set_element_value(&data, &meta->element, obj->dconn, value);
+    if (dpiObject_setElementValueByIndex(obj->handle, idx, meta->element.native_type, &data) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(obj);
     }
     RB_GC_GUARD(gc_guard);
     return Qnil;
 }
 
+static VALUE object_to_a(VALUE self)
+{
+    Object_t *obj = To_Object(self);
+    objtype_meta_t *meta = object_meta(obj);
+
+    check_collection(meta, true);
+    return object_to_ruby(obj->handle, meta, obj->dconn, 0);
+}
+
+static VALUE object_to_h(VALUE self)
+{
+    Object_t *obj = To_Object(self);
+
+    return object_to_ruby(obj->handle, object_meta(obj), obj->dconn, OBJ_INDEX_HASH);
+}
+
+static VALUE object_to_struct(VALUE self)
+{
+    Object_t *obj = To_Object(self);
+
+    return object_to_ruby(obj->handle, object_meta(obj), obj->dconn, OBJ_STRUCT);
+}
+
 static VALUE object_size(VALUE self)
 {
     GET_INT32(Object, Size);
@@ -343,7 +817,7 @@ static VALUE object_type_initialize(VALUE self, VALUE vconn, VALUE name)
 
     ExportString(name);
     RBORADB_INIT(objtype, dconn);
-    if (rbOraDBConn_getObjectType(dconn->handle, RSTRING_PTR(name), RSTRING_LEN(name), &objtype->handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_getObjectType(dconn, RSTRING_PTR(name), RSTRING_LEN(name), &objtype->handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(objtype);
     }
     return Qnil;
@@ -363,33 +837,59 @@ static VALUE object_type_info(VALUE self)
 static VALUE object_type_attributes(VALUE self)
 {
     ObjectType_t *objtype = To_ObjectType(self);
-    dpiObjectTypeInfo info;
-    dpiObjectAttr **attrs;
+    objtype_meta_t *meta = object_type_meta(objtype);
     uint16_t idx;
     VALUE ary;
 
-    if (dpiObjectType_getInfo(objtype->handle, &info) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(objtype);
-    }
-
-    if (info.isCollection) {
+    if (meta->is_collection) {
         return Qnil;
     }
-    attrs = ALLOCA_N(dpiObjectAttr*, info.numAttributes);
-    if (dpiObjectType_getAttributes(objtype->handle, info.numAttributes, attrs) != DPI_SUCCESS) {
-        RBORADB_RAISE_ERROR(objtype);
-    }
-    ary = rb_ary_new_capa(info.numAttributes);
-    for (idx = 0; idx < info.numAttributes; idx++) {
+    ary = rb_ary_new_capa(meta->num_attrs);
+    for (idx = 0; idx < meta->num_attrs; idx++) {
         ObjectAttr_t *objattr;
         VALUE obj = TypedData_Make_Struct(cObjectAttr, ObjectAttr_t, &object_attr_data_type, objattr);
 
-        RBORADB_SET(objattr, dpiObjectAttr, attrs[idx], objtype->dconn);
+        RBORADB_SET(objattr, dpiObjectAttr, meta->attrs[idx].handle, objtype->dconn);
+        objattr->type = meta->attrs[idx].type;
+        objattr->type.meta = NULL;
         rb_ary_push(ary, obj);
     }
     return ary;
 }
 
+static VALUE object_type_ruby_class(VALUE self)
+{
+    ObjectType_t *objtype = To_ObjectType(self);
+    objtype_meta_t *meta = object_type_meta(objtype);
+
+    if (meta->is_collection) {
+        return Qnil;
+    }
+    return struct_class(meta);
+}
+
+static VALUE object_type_from_array(VALUE self, VALUE ary)
+{
+    ObjectType_t *objtype = To_ObjectType(self);
+    objtype_meta_t *meta = object_type_meta(objtype);
+
+    if (!meta->is_collection) {
+        rb_raise(rb_eArgError, "self isn't a collection type.");
+    }
+    return new_object_from(meta, ary, objtype->dconn);
+}
+
+static VALUE object_type_from_hash(VALUE self, VALUE hash)
+{
+    ObjectType_t *objtype = To_ObjectType(self);
+    objtype_meta_t *meta = object_type_meta(objtype);
+
+    if (meta->is_collection) {
+        rb_raise(rb_eArgError, "self is a collection type.");
+    }
+    return new_object_from(meta, hash, objtype->dconn);
+}
+
 static VALUE object_attr_alloc(VALUE klass)
 {
     ObjectAttr_t *objattr;
@@ -409,6 +909,8 @@ static VALUE object_attr_info(VALUE self)
 
 void rboradb_object_init(VALUE mOracleDB)
 {
+    struct_classes = st_init_strtable();
+
     cObject = rb_define_class_under(mOracleDB, "Object", rb_cObject);
     rb_define_alloc_func(cObject, object_alloc);
     rb_define_method(cObject, "initialize", object_initialize, 1);
@@ -425,6 +927,9 @@ void rboradb_object_init(VALUE mOracleDB)
     rb_define_method(cObject, "set_attribute_value", object_set_attribute_value, 2);
     rb_define_method(cObject, "set_element_value_by_index", object_set_element_value_by_index, 2);
     rb_define_method(cObject, "size", object_size, 0);
+    rb_define_method(cObject, "to_a", object_to_a, 0);
+    rb_define_method(cObject, "to_h", object_to_h, 0);
+    rb_define_method(cObject, "to_struct", object_to_struct, 0);
     rb_define_method(cObject, "trim", object_trim, 1);
 
     cObjectType = rb_define_class_under(mOracleDB, "ObjectType", rb_cObject);
@@ -433,6 +938,9 @@ void rboradb_object_init(VALUE mOracleDB)
     rb_define_private_method(cObjectType, "initialize_copy", rboradb_notimplement, -1);
     rb_define_private_method(cObjectType, "__info", object_type_info, 0);
     rb_define_private_method(cObjectType, "__attributes", object_type_attributes, 0);
+    rb_define_method(cObjectType, "from_array", object_type_from_array, 1);
+    rb_define_method(cObjectType, "from_hash", object_type_from_hash, 1);
+    rb_define_method(cObjectType, "ruby_class", object_type_ruby_class, 0);
 
     cObjectAttr = rb_define_class_under(mOracleDB, "ObjectAttr", rb_cObject);
     rb_define_alloc_func(cObjectAttr, object_attr_alloc);
@@ -491,3 +999,46 @@ dpiObjectType *rboradb_to_dpiObjectType(VALUE obj)
 {
     return To_ObjectType(obj)->handle;
 }
+
+// Metadata referenced while ruby code may run and evict it from the cache.
+typedef struct {
+    objtype_meta_t *meta;
+    dpiObject *handle;
+    VALUE value;
+    rbOraDBConn *dconn;
+} meta_call_t;
+
+static VALUE call_object_to_struct(VALUE arg)
+{
+    meta_call_t *call = (meta_call_t *)arg;
+    return object_to_ruby(call->handle, call->meta, call->dconn, OBJ_STRUCT);
+}
+
+static VALUE call_new_object_from(VALUE arg)
+{
+    meta_call_t *call = (meta_call_t *)arg;
+    return new_object_from(call->meta, call->value, call->dconn);
+}
+
+static VALUE release_call_meta(VALUE arg)
+{
+    objtype_meta_release(((meta_call_t *)arg)->meta);
+    return Qnil;
+}
+
+// Converts a fetched object to a struct, or an array of structs for
+// collections, without creating OracleDB::Object.
+VALUE rboradb_dpiObject_to_struct(dpiObject *handle, dpiObjectType *objtype, rbOraDBConn *dconn)
+{
+    meta_call_t call = {get_objtype_meta(objtype, dconn), handle, Qnil, dconn};
+
+    return rb_ensure(call_object_to_struct, (VALUE)&call, release_call_meta, (VALUE)&call);
+}
+
+// Converts an array, a hash or a struct to an object of +objtype+.
+VALUE rboradb_to_object(VALUE value, dpiObjectType *objtype, rbOraDBConn *dconn)
+{
+    meta_call_t call = {get_objtype_meta(objtype, dconn), NULL, value, dconn};
+
+    return rb_ensure(call_new_object_from, (VALUE)&call, release_call_meta, (VALUE)&call);
+}
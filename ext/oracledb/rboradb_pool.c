@@ -27,7 +27,7 @@ typedef struct {
 static void pool_mark(void *arg)
 {
     Pool_t *pool = (Pool_t *)arg;
-    rb_gc_mark(pool->pool_name);
+    rb_gc_mark_movable(pool->pool_name);
 }
 
 static void pool_free(void *arg)
@@ -42,10 +42,21 @@ static void pool_free(void *arg)
     xfree(arg);
 }
 
+static size_t pool_memsize(const void *arg)
+{
+    return sizeof(Pool_t);
+}
+
+static void pool_compact(void *arg)
+{
+    Pool_t *pool = (Pool_t *)arg;
+    pool->pool_name = rb_gc_location(pool->pool_name);
+}
+
 static const struct rb_data_type_struct pool_data_type = {
     "OracleDB::Pool",
-    {pool_mark, pool_free,},
-    NULL, NULL,
+    {pool_mark, pool_free, pool_memsize, pool_compact,},
+    NULL, NULL, RBORADB_TYPED_DEFERRED_FLAGS,
 };
 
 static VALUE pool_alloc(VALUE klass)
@@ -86,7 +97,7 @@ static VALUE pool_initialize(int argc, VALUE *argv, VALUE self)
     rbOraDBContext_addRef(ctxt);
     pool->ctxt = ctxt;
     if (pool_params.outPoolName) {
-        pool->pool_name = rb_external_str_new_with_enc(pool_params.outPoolName, pool_params.outPoolNameLength, rb_utf8_encoding());
+        RB_OBJ_WRITE(self, &pool->pool_name, rb_external_str_new_with_enc(pool_params.outPoolName, pool_params.outPoolNameLength, rb_utf8_encoding()));
     }
     return Qnil;
 }
@@ -19,18 +19,22 @@
 typedef struct {
     dpiRowid *handle;
     rbOraDBContext *ctxt;
+    VALUE str; // cached string value
 } Rowid_t;
 
 static VALUE cRowid;
 
 static VALUE rowid_alloc(VALUE klass);
+static void rowid_mark(void *arg);
 static void rowid_free(void *arg);
+static size_t rowid_memsize(const void *arg);
+static void rowid_compact(void *arg);
 static VALUE rowid_to_s(VALUE self);
 
 static const struct rb_data_type_struct rowid_data_type = {
     "OracleDB::Rowid",
-    {NULL, rowid_free,},
-    NULL, NULL,
+    {rowid_mark, rowid_free, rowid_memsize, rowid_compact,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE rowid_alloc(VALUE klass)
@@ -39,6 +43,12 @@ static VALUE rowid_alloc(VALUE klass)
     return TypedData_Make_Struct(klass, Rowid_t, &rowid_data_type, rid);
 }
 
+static void rowid_mark(void *arg)
+{
+    Rowid_t *rid = (Rowid_t *)arg;
+    rb_gc_mark_movable(rid->str);
+}
+
 static void rowid_free(void *arg)
 {
     Rowid_t *rid = (Rowid_t *)arg;
@@ -53,6 +63,17 @@ static void rowid_free(void *arg)
     xfree(arg);
 }
 
+static size_t rowid_memsize(const void *arg)
+{
+    return sizeof(Rowid_t);
+}
+
+static void rowid_compact(void *arg)
+{
+    Rowid_t *rid = (Rowid_t *)arg;
+    rid->str = rb_gc_location(rid->str);
+}
+
 static VALUE rowid_to_s(VALUE self)
 {
     Rowid_t *rid = To_Rowid(self);
@@ -62,10 +83,13 @@ static VALUE rowid_to_s(VALUE self)
     if (rid == NULL || rid->handle == NULL) {
         rb_raise(rb_eRuntimeError, "uinitialized %s", rb_obj_classname(self));
     }
-    if (dpiRowid_getStringValue(rid->handle, &val, &len) != DPI_SUCCESS) {
-        rboradb_raise_error(rid->ctxt);
+    if (!RTEST(rid->str)) {
+        if (dpiRowid_getStringValue(rid->handle, &val, &len) != DPI_SUCCESS) {
+            rboradb_raise_error(rid->ctxt);
+        }
+        RB_OBJ_WRITE(self, &rid->str, rb_obj_freeze(rb_str_new(val, len)));
     }
-    return rb_str_new(val, len);
+    return rid->str;
 }
 
 void rboradb_rowid_init(VALUE mOracleDB)
@@ -75,6 +99,7 @@ void rboradb_rowid_init(VALUE mOracleDB)
     rb_define_method(cRowid, "initialize", rboradb_notimplement, -1);
     rb_define_private_method(cRowid, "initialize_copy", rboradb_notimplement, -1);
     rb_define_method(cRowid, "to_s", rowid_to_s, 0);
+    rb_define_const(cRowid, "SIZE", INT2FIX(RBORADB_ROWID_SIZE));
 }
 
 VALUE rboradb_from_dpiRowid(dpiRowid *handle, rbOraDBConn *dconn, int ref)
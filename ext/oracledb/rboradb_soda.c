@@ -64,22 +64,37 @@ static VALUE init_oper_options(dpiSodaOperOptions *dpi_opts, VALUE opts, rbOraDB
     return rboradb_set_dpiSodaOperOptions(dpi_opts, opts);
 }
 
+static size_t soda_coll_memsize(const void *arg)
+{
+    return sizeof(SodaColl_t);
+}
+
 static const struct rb_data_type_struct soda_coll_data_type = {
     "OracleDB::Soda::Coll",
-    {NULL, soda_coll_free,},
-    NULL, NULL,
+    {NULL, soda_coll_free, soda_coll_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
+static size_t soda_db_memsize(const void *arg)
+{
+    return sizeof(SodaDb_t);
+}
+
 static const struct rb_data_type_struct soda_db_data_type = {
     "OracleDB::Soda::Db",
-    {NULL, soda_db_free,},
-    NULL, NULL,
+    {NULL, soda_db_free, soda_db_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
+static size_t soda_doc_memsize(const void *arg)
+{
+    return sizeof(SodaDoc_t);
+}
+
 static const struct rb_data_type_struct soda_doc_data_type = {
     "OracleDB::Soda::Doc",
-    {NULL, soda_doc_free,},
-    NULL, NULL,
+    {NULL, soda_doc_free, soda_doc_memsize,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE soda_coll_alloc(VALUE klass)
@@ -444,7 +459,7 @@ static VALUE soda_db_create_document(VALUE self, VALUE key, VALUE content, VALUE
     SafeStringValue(content);
     OptExportString(media_type);
     if (NIL_P(media_type) || (RSTRING_LEN(media_type) == application_json_len && memcmp(RSTRING_PTR(media_type), application_json, application_json_len) == 0)) {
-        content = rb_str_export_to_enc(content, rb_utf8_encoding());
+        content = rboradb_export_utf8(content);
     }
     if (dpiSodaDb_createDocument(db->handle, OPT_RSTRING_PTR(key), OPT_RSTRING_LEN(key),
         RSTRING_PTR(content), RSTRING_LEN(content), OPT_RSTRING_PTR(media_type), OPT_RSTRING_LEN(media_type), 0, &handle) != DPI_SUCCESS) {
@@ -37,10 +37,15 @@ static void stmt_free(void *arg)
     xfree(arg);
 }
 
+static size_t stmt_memsize(const void *arg)
+{
+    return sizeof(Stmt_t);
+}
+
 static const struct rb_data_type_struct stmt_data_type = {
     "OracleDB::Stmt",
-    {NULL, stmt_free,},
-    NULL, NULL,
+    {NULL, stmt_free, stmt_memsize,},
+    NULL, NULL, RBORADB_TYPED_DEFERRED_FLAGS,
 };
 
 static VALUE stmt_alloc(VALUE klass)
@@ -193,7 +198,7 @@ static VALUE stmt___execute(VALUE self, VALUE mode)
     Stmt_t *stmt = To_Stmt(self);
     uint32_t num_query_columns;
 
-    if (rbOraDBStmt_execute(stmt->dconn->handle, stmt->handle, rboradb_to_dpiExecMode(mode), &num_query_columns) != DPI_SUCCESS) {
+    if (rbOraDBStmt_execute(stmt->dconn, stmt->handle, rboradb_to_dpiExecMode(mode), &num_query_columns) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(stmt);
     }
     stmt->num_query_columns = num_query_columns;
@@ -204,7 +209,7 @@ static VALUE stmt___execute_many(VALUE self, VALUE mode, VALUE num_iters)
 {
     Stmt_t *stmt = To_Stmt(self);
 
-    if (rbOraDBStmt_executeMany(stmt->dconn->handle, stmt->handle, rboradb_to_dpiExecMode(mode), NUM2UINT(num_iters)) != DPI_SUCCESS) {
+    if (rbOraDBStmt_executeMany(stmt->dconn, stmt->handle, rboradb_to_dpiExecMode(mode), NUM2UINT(num_iters)) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(stmt);
     }
     return Qnil;
@@ -274,12 +279,26 @@ static VALUE stmt___fetch(VALUE self)
     Stmt_t *stmt = To_Stmt(self);
     int found;
 
-    if (rbOraDBStmt_fetch(stmt->dconn->handle, stmt->handle, &found, &stmt->buffer_row_index) != DPI_SUCCESS) {
+    if (rbOraDBStmt_fetch(stmt->dconn, stmt->handle, &found, &stmt->buffer_row_index) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(stmt);
     }
     return found ? UINT2NUM(stmt->buffer_row_index) : Qnil;
 }
 
+// Returns the buffer row index of the first row and the number of rows
+// fetched into the define variables at once.
+static VALUE stmt___fetch_rows(VALUE self, VALUE max_rows)
+{
+    Stmt_t *stmt = To_Stmt(self);
+    uint32_t num_rows;
+    int more_rows;
+
+    if (rbOraDBStmt_fetchRows(stmt->dconn, stmt->handle, NUM2UINT(max_rows), &stmt->buffer_row_index, &num_rows, &more_rows) != DPI_SUCCESS) {
+        RBORADB_RAISE_ERROR(stmt);
+    }
+    return rb_assoc_new(UINT2NUM(stmt->buffer_row_index), UINT2NUM(num_rows));
+}
+
 static VALUE stmt_row_count(VALUE self)
 {
     GET_UINT64(Stmt, RowCount);
@@ -314,7 +333,7 @@ static VALUE stmt_scroll(int argc, VALUE *argv, VALUE self)
     VALUE offset;
 
     rb_scan_args(argc, argv, "11", &mode, &offset);
-    if (rbOraDBStmt_scroll(stmt->dconn->handle, stmt->handle, rboradb_to_dpiFetchMode(mode), NIL_P(offset) ? 0 : NUM2INT(offset), stmt->buffer_row_index) != DPI_SUCCESS) {
+    if (rbOraDBStmt_scroll(stmt->dconn, stmt->handle, rboradb_to_dpiFetchMode(mode), NIL_P(offset) ? 0 : NUM2INT(offset), stmt->buffer_row_index) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(stmt);
     }
     return Qnil;
@@ -410,6 +429,9 @@ void rboradb_stmt_init(VALUE mOracleDB)
     rb_define_method(cStmt, "prefetch_rows", stmt_prefetch_rows, 0);
     rb_define_method(cStmt, "query_info", stmt_query_info, 1);
     rb_define_private_method(cStmt, "__fetch", stmt___fetch, 0);
+    rb_define_private_method(cStmt, "__fetch_rows", stmt___fetch_rows, 1);
+    rb_define_private_method(cStmt, "__push_deadline", rboradb_push_deadline, 1);
+    rb_define_private_method(cStmt, "__pop_deadline", rboradb_pop_deadline, 1);
     rb_define_method(cStmt, "row_count", stmt_row_count, 0);
     rb_define_method(cStmt, "row_counts", stmt_row_counts, 0);
     rb_define_method(cStmt, "subscr_query_id", stmt_subscr_query_id, 0);
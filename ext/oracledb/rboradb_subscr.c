@@ -93,10 +93,17 @@ static VALUE from_dpiSubscrMessageQuery(const dpiSubscrMessageQuery *query);
 static VALUE from_dpiSubscrMessageTable(const dpiSubscrMessageTable *tbl);
 static VALUE from_dpiSubscrMessageRow(const dpiSubscrMessageRow *row);
 
+static size_t subscr_memsize(const void *arg)
+{
+    return sizeof(Subscr_t);
+}
+
+// The callback is pinned by rb_gc_mark() because queued messages refer
+// to it outside the GC.
 static const struct rb_data_type_struct subscr_data_type = {
     "OracleDB::Subscr",
-    {subscr_mark, subscr_free,},
-    NULL, NULL,
+    {subscr_mark, subscr_free, subscr_memsize,},
+    NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY,
 };
 
 static VALUE to_ruby_msg(VALUE args)
@@ -375,7 +382,7 @@ static VALUE subscr_initialize(VALUE self, VALUE conn, VALUE params)
         prms.callback = subscr_callback;
         prms.callbackContext = subscr;
     }
-    if (rbOraDBConn_subscribe(dconn->handle, &prms, &handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_subscribe(dconn, &prms, &handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(subscr);
     }
     RBORADB_INIT(subscr, dconn);
@@ -420,7 +427,7 @@ static VALUE subscr_unsubscribe(VALUE self)
 {
     Subscr_t *subscr = To_Subscr(self);
 
-    if (rbOraDBConn_unsubscribe(subscr->dconn->handle, subscr->handle) != DPI_SUCCESS) {
+    if (rbOraDBConn_unsubscribe(subscr->dconn, subscr->handle) != DPI_SUCCESS) {
         RBORADB_RAISE_ERROR(subscr);
     }
     return Qnil;
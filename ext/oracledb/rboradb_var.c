@@ -16,6 +16,16 @@
 
 #define To_Var(obj) ((Var_t *)rb_check_typeddata((obj), &var_data_type))
 
+// The number of slots of column_dedup caches and the max length of
+// cached values. Longer values are unlikely to repeat.
+#define STR_CACHE_SIZE 256
+#define STR_CACHE_MAX_LEN 64
+
+typedef struct {
+    st_index_t hash;
+    VALUE str;
+} str_cache_entry_t;
+
 typedef struct {
     RBORADB_COMMON_HEADER(dpiVar);
     dpiData *data;
@@ -25,17 +35,25 @@ typedef struct {
     dpiObjectType *objtype;
     VALUE out_filter;
     VALUE in_filter;
+    str_cache_entry_t *str_cache;
+    size_t buffer_size; // estimated size of buffers allocated by ODPI-C
 } Var_t;
 
 static VALUE cVar;
-static VALUE sym_to_i;
-static VALUE sym_to_f;
+static VALUE sym_from_json;
+static VALUE sym_column_dedup;
 
 static void var_mark(void *arg)
 {
     Var_t *obj = (Var_t *)arg;
-    rb_gc_mark(obj->out_filter);
-    rb_gc_mark(obj->in_filter);
+    rb_gc_mark_movable(obj->out_filter);
+    rb_gc_mark_movable(obj->in_filter);
+    if (obj->str_cache) {
+        int i;
+        for (i = 0; i < STR_CACHE_SIZE; i++) {
+            rb_gc_mark_movable(obj->str_cache[i].str);
+        }
+    }
 }
 
 static void var_free(void *arg)
@@ -45,13 +63,41 @@ static void var_free(void *arg)
         dpiObjectType_release(var->objtype);
     }
     RBORADB_RELEASE(var, dpiVar);
+    if (var->buffer_size) {
+        rb_gc_adjust_memory_usage(-(ssize_t)var->buffer_size);
+    }
+    xfree(var->str_cache);
     xfree(arg);
 }
 
+static size_t var_memsize(const void *arg)
+{
+    const Var_t *var = (const Var_t *)arg;
+    size_t size = sizeof(Var_t) + var->buffer_size;
+
+    if (var->str_cache) {
+        size += sizeof(str_cache_entry_t) * STR_CACHE_SIZE;
+    }
+    return size;
+}
+
+static void var_compact(void *arg)
+{
+    Var_t *obj = (Var_t *)arg;
+    obj->out_filter = rb_gc_location(obj->out_filter);
+    obj->in_filter = rb_gc_location(obj->in_filter);
+    if (obj->str_cache) {
+        int i;
+        for (i = 0; i < STR_CACHE_SIZE; i++) {
+            obj->str_cache[i].str = rb_gc_location(obj->str_cache[i].str);
+        }
+    }
+}
+
 static const struct rb_data_type_struct var_data_type = {
     "OracleDB::Var",
-    {var_mark, var_free,},
-    NULL, NULL,
+    {var_mark, var_free, var_memsize, var_compact,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
 };
 
 static VALUE var_alloc(VALUE klass)
@@ -60,19 +106,6 @@ static VALUE var_alloc(VALUE klass)
     return TypedData_Make_Struct(klass, Var_t, &var_data_type, coll);
 }
 
-static VALUE to_proc(VALUE proc, const char *name)
-{
-    if (NIL_P(proc) || rb_obj_is_proc(proc)) {
-        return proc;
-    }
-    if (RB_SYMBOL_P(proc)) {
-        static ID id;
-        CONST_ID(id, "to_proc");
-        return rb_funcall(proc, id, 0);
-    }
-    rb_raise(rb_eArgError, "wrong %s type (given %s, expected nil, symbol, proc or lambda)", name, rb_obj_classname(proc));
-}
-
 static VALUE var_initialize(VALUE self, VALUE conn, VALUE oracle_type, VALUE native_type, VALUE max_array_size, VALUE size, VALUE size_is_bytes, VALUE is_array, VALUE objtype, VALUE out_filter, VALUE in_filter)
 {
     Var_t *var = To_Var(self);
@@ -81,6 +114,7 @@ static VALUE var_initialize(VALUE self, VALUE conn, VALUE oracle_type, VALUE nat
     dpiNativeTypeNum native_type_num = rboradb_to_dpiNativeTypeNum(native_type);
     dpiObjectType *dpiobjtype = NIL_P(objtype) ? NULL : rboradb_to_dpiObjectType(objtype);
     uint32_t array_size = NUM2UINT(max_array_size);
+    uint32_t elem_size;
 
     RBORADB_INIT(var, dconn);
     if (dpiConn_newVar(dconn->handle, oracle_type_num, native_type_num, array_size, NIL_P(size) ? 0 : NUM2UINT(size), RTEST(size_is_bytes),
@@ -88,21 +122,58 @@ static VALUE var_initialize(VALUE self, VALUE conn, VALUE oracle_type, VALUE nat
         rboradb_raise_error(dconn->ctxt);
     }
     var->array_size = array_size;
+    // Let the GC know the buffers behind the small object. Each element
+    // has a dpiData and a buffer of the size in bytes.
+    if (dpiVar_getSizeInBytes(var->handle, &elem_size) == DPI_SUCCESS) {
+        var->buffer_size = (size_t)array_size * (sizeof(dpiData) + elem_size);
+        rb_gc_adjust_memory_usage((ssize_t)var->buffer_size);
+    }
     var->native_type_num = native_type_num;
     var->oracle_type_num = oracle_type_num;
     var->objtype = dpiobjtype;
     if (var->objtype) {
         dpiObjectType_addRef(var->objtype);
     }
-    if (native_type_num == DPI_NATIVE_TYPE_BYTES && (out_filter == sym_to_i || out_filter == sym_to_f)) {
-        var->out_filter = out_filter;
-    } else {
-        var->out_filter = to_proc(out_filter, "out_filter");
+    RB_OBJ_WRITE(self, &var->out_filter, rboradb_to_filter(out_filter, native_type_num, 0));
+    RB_OBJ_WRITE(self, &var->in_filter, rboradb_to_filter(in_filter, native_type_num, 1));
+    if (var->out_filter == sym_column_dedup) {
+        var->str_cache = ZALLOC_N(str_cache_entry_t, STR_CACHE_SIZE);
     }
-    var->in_filter = to_proc(in_filter, "in_filter");
     return Qnil;
 }
 
+// Returns a frozen string shared by equal values in the column. The cache
+// is direct-mapped; a colliding value replaces the previous one.
+static VALUE var_cached_str(VALUE self, Var_t *var, const dpiBytes *bytes)
+{
+    st_index_t hash;
+    str_cache_entry_t *entry;
+    VALUE str;
+
+    if (bytes->length > STR_CACHE_MAX_LEN) {
+        return rb_obj_freeze(rboradb_enc_str_new(bytes->ptr, bytes->length, rboradb_bytes_encoding(var->oracle_type_num)));
+    }
+    hash = rb_memhash(bytes->ptr, bytes->length);
+    entry = &var->str_cache[hash % STR_CACHE_SIZE];
+    str = entry->str;
+    if (RTEST(str) && entry->hash == hash && RSTRING_LEN(str) == bytes->length
+        && memcmp(RSTRING_PTR(str), bytes->ptr, bytes->length) == 0) {
+        return str;
+    }
+    str = rb_obj_freeze(rboradb_enc_str_new(bytes->ptr, bytes->length, rboradb_bytes_encoding(var->oracle_type_num)));
+    entry->hash = hash;
+    RB_OBJ_WRITE(self, &entry->str, str);
+    return str;
+}
+
+static VALUE var_from_data(VALUE self, Var_t *var, const dpiData *data)
+{
+    if (var->str_cache) {
+        return data->isNull ? Qnil : var_cached_str(self, var, &data->value.asBytes);
+    }
+    return rboradb_from_data(data, var->native_type_num, var->oracle_type_num, var->objtype, var->out_filter, var->dconn);
+}
+
 static VALUE var_get(VALUE self, VALUE index)
 {
     Var_t *var = To_Var(self);
@@ -112,7 +183,7 @@ static VALUE var_get(VALUE self, VALUE index)
         rb_raise(rb_eArgError, "wrong row index (given %u, expected between 0 and %u)",
             idx, var->array_size - 1);
     }
-    return rboradb_from_data(var->data + idx, var->native_type_num, var->oracle_type_num, var->objtype, var->out_filter, var->dconn);
+    return var_from_data(self, var, var->data + idx);
 }
 
 static VALUE var_returned_data(VALUE self, VALUE pos)
@@ -128,7 +199,7 @@ static VALUE var_returned_data(VALUE self, VALUE pos)
 
     ary = rb_ary_new_capa(num);
     for (idx = 0; idx < num; idx++) {
-        VALUE obj = rboradb_from_data(data + idx, var->native_type_num, var->oracle_type_num, var->objtype, var->out_filter, var->dconn);
+        VALUE obj = var_from_data(self, var, data + idx);
         rb_ary_push(ary, obj);
     }
     return ary;
@@ -150,13 +221,129 @@ static VALUE var_set(VALUE self, VALUE index, VALUE obj)
         return Qnil;
     }
 
+    if (var->in_filter == sym_from_json) {
+        rboradb_text2dpiJson(obj, data->value.asJson, var->dconn);
+        data->isNull = 0;
+        return Qnil;
+    }
     if (!NIL_P(var->in_filter)) {
-        obj = rb_proc_call_with_block(var->in_filter, 1, &obj, Qnil);
+        obj = rboradb_apply_filter(var->in_filter, obj, 1);
+    }
+    if (var->native_type_num == DPI_NATIVE_TYPE_OBJECT && var->objtype
+            && (RB_TYPE_P(obj, T_STRUCT) || RB_TYPE_P(obj, T_HASH) || RB_TYPE_P(obj, T_ARRAY))) {
+        obj = rboradb_to_object(obj, var->objtype, var->dconn);
     }
     rboradb_set_data(obj, data, var->native_type_num, var->oracle_type_num, var->dconn, var->handle, pos);
     return Qnil;
 }
 
+static void check_rows(Var_t *var, uint32_t idx, uint32_t num)
+{
+    if (idx > var->array_size || num > var->array_size - idx) {
+        rb_raise(rb_eArgError, "rows %u to %u out of the array size %u", idx, idx + num, var->array_size);
+    }
+}
+
+// Width of each value in strings of rowids. It is Rowid::SIZE unless
+// given. Universal rowids, such as ones of index-organized tables, are
+// longer.
+static uint32_t rowid_width(VALUE width)
+{
+    uint32_t w = NIL_P(width) ? RBORADB_ROWID_SIZE : NUM2UINT(width);
+
+    if (w == 0) {
+        rb_raise(rb_eArgError, "width must be positive");
+    }
+    return w;
+}
+
+// Returns rowids in +num+ rows from +index+ as one string of space-padded
+// +width+-byte values without creating an object per row. NULL values
+// are all spaces.
+static VALUE var_get_rowids(int argc, VALUE *argv, VALUE self)
+{
+    Var_t *var = To_Var(self);
+    VALUE index, num, width;
+    uint32_t idx, i, n, w;
+    VALUE str;
+    char *buf;
+
+    rb_scan_args(argc, argv, "21", &index, &num, &width);
+    idx = NUM2UINT(index);
+    n = NUM2UINT(num);
+    w = rowid_width(width);
+
+    if (var->native_type_num != DPI_NATIVE_TYPE_ROWID && var->native_type_num != DPI_NATIVE_TYPE_BYTES) {
+        rb_raise(rb_eTypeError, "not a rowid or bytes variable");
+    }
+    check_rows(var, idx, n);
+    str = rb_usascii_str_new(NULL, (long)n * w);
+    buf = RSTRING_PTR(str);
+    memset(buf, ' ', (size_t)n * w);
+    for (i = 0; i < n; i++) {
+        const dpiData *data = var->data + idx + i;
+        const char *ptr;
+        uint32_t len;
+
+        if (data->isNull) {
+            continue;
+        }
+        if (var->native_type_num == DPI_NATIVE_TYPE_ROWID) {
+            if (dpiRowid_getStringValue(data->value.asRowid, &ptr, &len) != DPI_SUCCESS) {
+                rboradb_raise_error(var->dconn->ctxt);
+            }
+        } else {
+            ptr = data->value.asBytes.ptr;
+            len = data->value.asBytes.length;
+        }
+        if (len > w) {
+            rb_raise(rb_eArgError, "rowid of %u bytes at row %u is longer than the width %u", len, idx + i, w);
+        }
+        memcpy(buf + (size_t)i * w, ptr, len);
+    }
+    return str;
+}
+
+// Sets values from a string returned by Var#get_rowids with the same
+// +width+. Rowids are bound as strings because ODPI-C cannot make rowid
+// handles from strings.
+static VALUE var_set_rowids(int argc, VALUE *argv, VALUE self)
+{
+    Var_t *var = To_Var(self);
+    VALUE index, rowids, width;
+    uint32_t idx, i, n, w;
+    const char *ptr;
+
+    rb_scan_args(argc, argv, "21", &index, &rowids, &width);
+    idx = NUM2UINT(index);
+    w = rowid_width(width);
+    if (var->native_type_num != DPI_NATIVE_TYPE_BYTES) {
+        rb_raise(rb_eTypeError, "not a bytes variable");
+    }
+    StringValue(rowids);
+    if (RSTRING_LEN(rowids) % w != 0) {
+        rb_raise(rb_eArgError, "length %ld is not a multiple of %u", RSTRING_LEN(rowids), w);
+    }
+    n = (uint32_t)(RSTRING_LEN(rowids) / w);
+    check_rows(var, idx, n);
+    ptr = RSTRING_PTR(rowids);
+    for (i = 0; i < n; i++) {
+        const char *val = ptr + (size_t)i * w;
+        uint32_t len = w;
+
+        while (len > 0 && val[len - 1] == ' ') {
+            len--;
+        }
+        if (len == 0) {
+            var->data[idx + i].isNull = 1;
+        } else if (dpiVar_setFromBytes(var->handle, idx + i, val, len) != DPI_SUCCESS) {
+            rboradb_raise_error(var->dconn->ctxt);
+        }
+    }
+    RB_GC_GUARD(rowids);
+    return UINT2NUM(n);
+}
+
 static VALUE var_copy_data(VALUE self, VALUE pos, VALUE source_var, VALUE source_pos)
 {
     Var_t *var = To_Var(self);
@@ -184,8 +371,8 @@ static VALUE var_size_in_bytes(VALUE self)
 
 void rboradb_var_init(VALUE mOracleDB)
 {
-    sym_to_i = ID2SYM(rb_intern("to_i"));
-    sym_to_f = ID2SYM(rb_intern("to_f"));
+    sym_from_json = ID2SYM(rb_intern("from_json"));
+    sym_column_dedup = ID2SYM(rb_intern("column_dedup"));
 
     cVar = rb_define_class_under(mOracleDB, "Var", rb_cObject);
     rb_define_alloc_func(cVar, var_alloc);
@@ -194,6 +381,8 @@ void rboradb_var_init(VALUE mOracleDB)
     rb_define_method(cVar, "get", var_get, 1);
     rb_define_method(cVar, "returned_data", var_returned_data, 1);
     rb_define_method(cVar, "set", var_set, 2);
+    rb_define_method(cVar, "get_rowids", var_get_rowids, -1);
+    rb_define_method(cVar, "set_rowids", var_set_rowids, -1);
     rb_define_method(cVar, "copy_data", var_copy_data, 3);
     rb_define_method(cVar, "num_elements_in_array", var_num_elements_in_array, 0);
     rb_define_method(cVar, "num_elements_in_array=", var_set_num_elements_in_array, 1);
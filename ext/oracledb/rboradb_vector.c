@@ -0,0 +1,255 @@
+// ruby-oracledb - Ruby binding for Oracle database based on ODPI-C
+//
+// URL: https://github.com/kubo/ruby-oracledb
+//
+//-----------------------------------------------------------------------------
+// Copyright (c) 2021 Kubo Takehiro <kubo@jiubao.org>. All rights reserved.
+// This program is free software: you can modify it and/or redistribute it
+// under the terms of:
+//
+// (i)  the Universal Permissive License v 1.0 or at your option, any
+//      later version (http://oss.oracle.com/licenses/upl); and/or
+//
+// (ii) the Apache License v 2.0. (http://www.apache.org/licenses/LICENSE-2.0)
+//-----------------------------------------------------------------------------
+#include "rboradb.h"
+
+#ifdef RBORADB_HAVE_VECTOR
+
+#define To_Vector(obj) ((Vector_t *)rb_check_typeddata((obj), &vector_data_type))
+
+// Elements are kept packed in a binary string in the native byte order.
+// Ruby objects per element are created only by Vector#to_a.
+typedef struct {
+    VALUE data;
+    uint32_t num_dimensions;
+    uint8_t format;
+} Vector_t;
+
+static VALUE cVector;
+
+static void vector_mark(void *arg)
+{
+    Vector_t *vec = (Vector_t *)arg;
+    rb_gc_mark_movable(vec->data);
+}
+
+static size_t vector_memsize(const void *arg)
+{
+    return sizeof(Vector_t);
+}
+
+static void vector_compact(void *arg)
+{
+    Vector_t *vec = (Vector_t *)arg;
+    vec->data = rb_gc_location(vec->data);
+}
+
+static const struct rb_data_type_struct vector_data_type = {
+    "OracleDB::Vector",
+    {vector_mark, RUBY_TYPED_DEFAULT_FREE, vector_memsize, vector_compact,},
+    NULL, NULL, RBORADB_TYPED_FLAGS,
+};
+
+static long element_size(uint8_t format)
+{
+    switch (format) {
+    case DPI_VECTOR_FORMAT_FLOAT32:
+        return sizeof(float);
+    case DPI_VECTOR_FORMAT_FLOAT64:
+        return sizeof(double);
+    }
+    return 1;
+}
+
+// Binary vectors pack eight dimensions in one byte.
+static uint32_t dimensions_per_element(uint8_t format)
+{
+#ifdef DPI_VECTOR_FORMAT_BINARY
+    if (format == DPI_VECTOR_FORMAT_BINARY) {
+        return 8;
+    }
+#endif
+    return 1;
+}
+
+static VALUE vector_alloc(VALUE klass)
+{
+    Vector_t *vec;
+    VALUE obj = TypedData_Make_Struct(klass, Vector_t, &vector_data_type, vec);
+    vec->data = Qnil;
+    return obj;
+}
+
+static VALUE pack_array(VALUE ary, uint8_t format)
+{
+    long i, len = RARRAY_LEN(ary);
+    VALUE str = rb_str_new(NULL, len * element_size(format));
+    char *ptr = RSTRING_PTR(str);
+
+    for (i = 0; i < len; i++) {
+        VALUE elem = RARRAY_AREF(ary, i);
+        int ival;
+
+        switch (format) {
+        case DPI_VECTOR_FORMAT_FLOAT32:
+            ((float *)ptr)[i] = (float)NUM2DBL(elem);
+            break;
+        case DPI_VECTOR_FORMAT_FLOAT64:
+            ((double *)ptr)[i] = NUM2DBL(elem);
+            break;
+        case DPI_VECTOR_FORMAT_INT8:
+            ival = NUM2INT(elem);
+            if (ival < INT8_MIN || INT8_MAX < ival) {
+                rb_raise(rb_eRangeError, "%d out of range of int8", ival);
+            }
+            ((int8_t *)ptr)[i] = (int8_t)ival;
+            break;
+        default:
+            ival = NUM2INT(elem);
+            if (ival < 0 || UINT8_MAX < ival) {
+                rb_raise(rb_eRangeError, "%d out of range of uint8", ival);
+            }
+            ((uint8_t *)ptr)[i] = (uint8_t)ival;
+        }
+    }
+    return str;
+}
+
+// Vector.new(format, values)
+//
+// +values+ is an array of numbers or a string of packed elements in
+// the native byte order such as [1.0, 2.0].pack("f*") for :float32.
+static VALUE vector_initialize(VALUE self, VALUE format, VALUE values)
+{
+    Vector_t *vec = To_Vector(self);
+    uint8_t fmt = (uint8_t)rboradb_to_dpiVectorFormat(format);
+    long size = element_size(fmt);
+    VALUE data;
+
+    if (RB_TYPE_P(values, T_ARRAY)) {
+        data = pack_array(values, fmt);
+    } else {
+        StringValue(values);
+        if (RSTRING_LEN(values) % size != 0) {
+            rb_raise(rb_eArgError, "data length %ld is not a multiple of %ld", RSTRING_LEN(values), size);
+        }
+        data = rb_str_new(RSTRING_PTR(values), RSTRING_LEN(values));
+    }
+    vec->format = fmt;
+    vec->num_dimensions = (uint32_t)(RSTRING_LEN(data) / size) * dimensions_per_element(fmt);
+    RB_OBJ_WRITE(self, &vec->data, rb_obj_freeze(data));
+    return self;
+}
+
+// Objects made by allocate have no format and no data.
+static Vector_t *to_initialized_vector(VALUE obj)
+{
+    Vector_t *vec = To_Vector(obj);
+
+    if (NIL_P(vec->data)) {
+        rb_raise(rb_eRuntimeError, "uninitialized %s", rb_obj_classname(obj));
+    }
+    return vec;
+}
+
+static VALUE vector_format(VALUE self)
+{
+    return rboradb_from_dpiVectorFormat(to_initialized_vector(self)->format);
+}
+
+static VALUE vector_num_dimensions(VALUE self)
+{
+    return UINT2NUM(to_initialized_vector(self)->num_dimensions);
+}
+
+static VALUE vector_data(VALUE self)
+{
+    return to_initialized_vector(self)->data;
+}
+
+static VALUE vector_to_a(VALUE self)
+{
+    Vector_t *vec = to_initialized_vector(self);
+    const char *ptr = RSTRING_PTR(vec->data);
+    long i, len = RSTRING_LEN(vec->data) / element_size(vec->format);
+    VALUE ary = rb_ary_new_capa(len);
+
+    for (i = 0; i < len; i++) {
+        switch (vec->format) {
+        case DPI_VECTOR_FORMAT_FLOAT32:
+            rb_ary_push(ary, DBL2NUM(((const float *)ptr)[i]));
+            break;
+        case DPI_VECTOR_FORMAT_FLOAT64:
+            rb_ary_push(ary, DBL2NUM(((const double *)ptr)[i]));
+            break;
+        case DPI_VECTOR_FORMAT_INT8:
+            rb_ary_push(ary, INT2FIX(((const int8_t *)ptr)[i]));
+            break;
+        default:
+            rb_ary_push(ary, INT2FIX(((const uint8_t *)ptr)[i]));
+        }
+    }
+    return ary;
+}
+
+void rboradb_vector_init(VALUE mOracleDB)
+{
+    cVector = rb_define_class_under(mOracleDB, "Vector", rb_cObject);
+    rb_define_alloc_func(cVector, vector_alloc);
+    rb_define_method(cVector, "initialize", vector_initialize, 2);
+    rb_define_method(cVector, "format", vector_format, 0);
+    rb_define_method(cVector, "num_dimensions", vector_num_dimensions, 0);
+    rb_define_method(cVector, "data", vector_data, 0);
+    rb_define_method(cVector, "to_a", vector_to_a, 0);
+}
+
+VALUE rboradb_from_dpiVector(dpiVector *handle, rbOraDBConn *dconn)
+{
+    dpiVectorInfo info;
+    Vector_t *vec;
+    VALUE obj;
+    long len;
+
+    if (dpiVector_getValue(handle, &info) != DPI_SUCCESS) {
+        rboradb_raise_error(dconn->ctxt);
+    }
+#if DPI_VERSION_NUMBER >= DPI_VERSION_TO_NUMBER(5, 4, 0)
+    if (info.numSparseValues != 0) {
+        rb_raise(rb_eNotImpError, "sparse vectors are not supported");
+    }
+#endif
+    len = (long)(info.numDimensions / dimensions_per_element(info.format)) * element_size(info.format);
+    obj = TypedData_Make_Struct(cVector, Vector_t, &vector_data_type, vec);
+    vec->data = Qnil;
+    vec->format = info.format;
+    vec->num_dimensions = info.numDimensions;
+    RB_OBJ_WRITE(obj, &vec->data, rb_obj_freeze(rb_str_new(info.dimensions.asPtr, len)));
+    return obj;
+}
+
+// The caller must release the returned handle.
+dpiVector *rboradb_to_dpiVector(VALUE obj, rbOraDBConn *dconn)
+{
+    Vector_t *vec = to_initialized_vector(obj);
+    dpiVectorInfo info = {0,};
+    dpiVector *handle;
+
+    info.format = vec->format;
+    info.numDimensions = vec->num_dimensions;
+    info.dimensionSize = (uint8_t)element_size(vec->format);
+    info.dimensions.asPtr = RSTRING_PTR(vec->data);
+    if (dpiConn_newVector(dconn->handle, &info, &handle) != DPI_SUCCESS) {
+        rboradb_raise_conn_error(dconn);
+    }
+    return handle;
+}
+
+#else
+
+void rboradb_vector_init(VALUE mOracleDB)
+{
+    // ODPI-C older than 5.3 doesn't support VECTOR.
+}
+
+#endif
@@ -4,13 +4,56 @@ require "oracledb/info_types"
 require "oracledb/object_types"
 
 module OracleDB
+  # Copies rows fetched by +from+ to +to+ by array DML of +insert_sql+.
+  # Rows are passed in batches of +batch_rows+ rows without converting
+  # them to ruby objects. Returns the number of inserted rows. The
+  # caller must commit +to+. +from+ is executed with its own define
+  # variables, so it must be executed again before fetching rows by it.
+  def self.copy(from:, to:, insert_sql:, batch_rows: 100)
+    __copy(from, to, insert_sql, batch_rows)
+  ensure
+    from.__send__(:reset_defines) if from.is_a?(Stmt)
+  end
+
+  # Deadlines enforced by a timer thread which breaks the execution of
+  # the connection when a deadline passes. The interrupted call raises
+  # OracleDB::TimeoutError. Calls to the database started after the
+  # deadline passes raise it without reaching the database.
+  module Deadline
+    def with_deadline(timeout)
+      return yield if timeout.nil?
+      prev = __push_deadline(timeout)
+      begin
+        yield
+      ensure
+        __pop_deadline(prev)
+      end
+    end
+  end
+
   class Conn
-    def prepare_stmt(sql, fetch_array_size: 100, scrollable: false, tag: nil)
-      __prepare_stmt(sql, fetch_array_size, scrollable, tag)
+    include Deadline
+
+    # The maximum number of temporary LOBs kept per LOB type.
+    MAX_POOLED_TMP_LOBS = 16
+
+    # When +fetch_lobs+ is false, CLOB and BLOB columns are fetched as
+    # strings in place of Lob objects. NCLOB columns are still fetched as
+    # Lob objects.
+    def prepare_stmt(sql, fetch_array_size: 100, scrollable: false, tag: nil, fetch_lobs: true)
+      stmt = __prepare_stmt(sql, fetch_array_size, scrollable, tag)
+      stmt.fetch_lobs = fetch_lobs
+      stmt
     end
 
+    # Object types are cached by +name+ to avoid round trips to the
+    # server. Call clear_object_types after the types are altered.
     def object_type(name)
-      ObjectType.new(self, name)
+      (@object_types ||= {})[name] ||= ObjectType.new(self, name)
+    end
+
+    def clear_object_types
+      @object_types = nil
     end
 
     def new_deq_options
@@ -29,8 +72,26 @@ module OracleDB
       Queue.new(self, name, payload)
     end
 
-    def new_tmp_lob(type)
-      Lob.new(self, type)
+    # Returns a temporary LOB. LOBs returned by release_tmp_lob are
+    # reused to avoid creating and freeing temporary LOBs.
+    def new_tmp_lob(type, value = nil)
+      lob = @tmp_lobs && @tmp_lobs[type]&.pop
+      return Lob.new(self, type, value) if lob.nil?
+      if value
+        lob.set(value)
+      else
+        lob.trim(0)
+        lob.seek(0)
+      end
+      lob
+    end
+
+    # Keeps a temporary LOB for later new_tmp_lob calls.
+    def release_tmp_lob(lob)
+      @tmp_lobs ||= Hash.new { |hash, key| hash[key] = [] }
+      lobs = @tmp_lobs[lob.type]
+      lobs << lob if lobs.size < MAX_POOLED_TMP_LOBS
+      nil
     end
 
     def subscribe(params)
@@ -38,10 +99,412 @@ module OracleDB
     end
   end
 
+  class Pool
+    # Runs a query on a pooled connection. When no result arrives within
+    # +hedge_after+ seconds, the same query runs on another connection.
+    # The first successful result wins and the other is cancelled.
+    def hedged_query(sql, binds = nil, hedge_after: 0.05)
+      results = Thread::Queue.new
+      attempts = [HedgedAttempt.new(self, sql, binds, results)]
+      if attempts[0].wait(hedge_after).nil?
+        begin
+          attempts << HedgedAttempt.new(self, sql, binds, results)
+        rescue OracleDB::Error
+          # no more sessions in the pool. wait for the first one.
+        end
+      end
+      error = nil
+      winner = nil
+      attempts.size.times do
+        attempt, rows, exc = results.pop
+        if exc.nil?
+          winner = attempt
+          return rows
+        end
+        error ||= exc
+      end
+      raise error
+    ensure
+      attempts&.each do |attempt|
+        attempt.cancel unless attempt.equal? winner
+      end
+    end
+
+    # Included by classes running statements on a pooled connection +@conn+
+    # in a thread. +cancel+ breaks the execution only while it is inside
+    # +executing+. A connection whose execution was broken is dropped
+    # from the pool by +close_conn+ because it may have a pending break.
+    module Cancellable
+      def cancel
+        @lock.synchronize do
+          @cancelled = true
+          if @executing
+            @broken = true
+            @conn.break_execution
+          end
+        end
+      end
+
+      private
+
+      def init_cancellable(pool)
+        @lock = Mutex.new
+        @cancelled = false
+        @executing = false
+        @broken = false
+        @conn = pool.acquire_connection(nil, nil)
+      end
+
+      def executing
+        @lock.synchronize do
+          return if @cancelled
+          @executing = true
+        end
+        begin
+          yield
+        ensure
+          @lock.synchronize { @executing = false }
+        end
+      end
+
+      def close_conn
+        @conn.close(@broken ? :drop : nil)
+      end
+    end
+    private_constant :Cancellable
+
+    class HedgedAttempt
+      include Cancellable
+
+      def initialize(pool, sql, binds, results)
+        init_cancellable(pool)
+        begin
+          stmt = @conn.prepare_stmt(sql)
+          raise ArgumentError, "hedged_query accepts only queries" unless stmt.info.is_query
+          stmt.bind_values(binds) if binds
+        rescue Exception
+          @conn.close
+          raise
+        end
+        @thread = Thread.new { run(stmt, results) }
+      end
+
+      def wait(timeout)
+        @thread.join(timeout)
+      end
+
+      private
+
+      def run(stmt, results)
+        rows = []
+        executing do
+          stmt.execute do |row|
+            break if @cancelled
+            rows << row
+          end
+        end
+        results << [self, rows, nil] unless @cancelled
+      rescue => e
+        results << [self, nil, e]
+      ensure
+        stmt.close
+        close_conn
+      end
+    end
+    private_constant :HedgedAttempt
+
+    ROWID_RANGES_SQL = <<~EOS
+      select dbms_rowid.rowid_create(1, data_object_id, lo_fno, lo_block, 0),
+             dbms_rowid.rowid_create(1, data_object_id, hi_fno, hi_block, 32767)
+        from (select data_object_id,
+                     min(relative_fno) keep (dense_rank first order by relative_fno, block_id) lo_fno,
+                     min(block_id) keep (dense_rank first order by relative_fno, block_id) lo_block,
+                     max(relative_fno) keep (dense_rank last order by relative_fno, block_id) hi_fno,
+                     max(block_id + blocks - 1) keep (dense_rank last order by relative_fno, block_id) hi_block
+                from (select o.data_object_id, e.relative_fno, e.block_id, e.blocks,
+                             trunc((sum(e.blocks) over (order by o.data_object_id, e.relative_fno, e.block_id) - e.blocks)
+                                   * :num_ranges / sum(e.blocks) over ()) grp
+                        from user_extents e, user_objects o
+                       where e.segment_name = :table_name
+                         and e.segment_type like 'TABLE%'
+                         and o.object_name = e.segment_name
+                         and o.object_type = e.segment_type
+                         and nvl(o.subobject_name, ' ') = nvl(e.partition_name, ' '))
+               group by data_object_id, grp)
+    EOS
+    private_constant :ROWID_RANGES_SQL
+
+    # Splits a query into disjoint parts, runs them on +parallelism+
+    # connections and yields arrays of fetched rows in order of arrival.
+    # Fetched batches wait in a queue of at most +queue_size+ batches.
+    #
+    # +split_by+ is one of:
+    # * +:rowid_range+ - rowid ranges over the extents of +table+
+    # * +:partition+ - one rowid range per partition of +table+
+    # * +[:mod, column]+ - <tt>mod(abs(trunc(column)), parallelism)</tt>,
+    #   where rows whose +column+ is null go to the first part
+    #
+    # +table+ must be in the current schema and +sql+ must be a query
+    # whose ROWID pseudo-column refers to it.
+    def parallel_query(sql, binds = nil, split_by:, parallelism: 4, table: nil, batch_rows: 100, queue_size: parallelism * 2, &block)
+      return enum_for(__method__, sql, binds, split_by: split_by, parallelism: parallelism, table: table, batch_rows: batch_rows, queue_size: queue_size) unless block
+      parts = Thread::Queue.new
+      parallel_query_parts(sql, binds, split_by, parallelism, table).each { |part| parts << part }
+      parts.close
+      batches = Thread::SizedQueue.new(queue_size)
+      workers = []
+      [parallelism, parts.size].min.times do
+        workers << ParallelWorker.new(self, parts, batches, batch_rows)
+      end
+      running = workers.size
+      while running > 0
+        batch = batches.pop
+        case batch
+        when Array
+          yield batch
+        when :done
+          running -= 1
+        else
+          raise batch
+        end
+      end
+      nil
+    ensure
+      batches&.close
+      workers&.each(&:cancel)
+    end
+
+    # Inserts +rows+, an enumerable of arrays ordered as +columns+, into
+    # +table+ by array DML on +sessions+ connections. Batches of
+    # +batch_rows+ rows wait in a queue of at most +queue_size+ batches
+    # while all sessions are busy.
+    #
+    # Values are bound as the types of the columns in +table+.
+    #
+    # +commit+ is +:batch+ to commit each batch or +:end+ to commit all
+    # sessions once after all rows are inserted. The APPEND_VALUES hint
+    # requires +:batch+ because a direct-path insert must be committed
+    # before the next insert into the same table. It is used by default
+    # only with one session because a direct-path insert locks the table
+    # exclusively and serializes the sessions.
+    #
+    # Returns a hash of the inserted row count and pairs of row indexes
+    # and errors of rows rejected by batch errors.
+    def bulk_load(table, columns, rows, sessions: 4, batch_rows: 1000, append_hint: nil, commit: :batch, queue_size: sessions * 2)
+      raise ArgumentError, "unknown commit: #{commit.inspect}" unless [:batch, :end].include? commit
+      append_hint = sessions == 1 && commit == :batch if append_hint.nil?
+      raise ArgumentError, "append_hint requires commit: :batch" if append_hint && commit != :batch
+      hint = append_hint ? "/*+ APPEND_VALUES */ " : ""
+      placeholders = Array.new(columns.size) { |idx| ":#{idx + 1}" }
+      sql = "insert #{hint}into #{table} (#{columns.join(', ')}) values (#{placeholders.join(', ')})"
+      batches = Thread::SizedQueue.new(queue_size)
+      results = Thread::Queue.new
+      column_infos = describe_columns(table, columns)
+      loaders = []
+      sessions.times do
+        loaders << BulkLoader.new(self, sql, column_infos, batches, results, batch_rows, commit == :batch)
+      end
+      offset = 0
+      begin
+        rows.each_slice(batch_rows) do |batch|
+          batches << [offset, batch]
+          offset += batch.size
+        end
+      rescue ClosedQueueError
+        # closed by a failed session
+      end
+      batches.close
+      row_count = 0
+      batch_errors = []
+      error = nil
+      loaders.size.times do
+        count, errors, exc = results.pop
+        row_count += count
+        batch_errors.concat(errors)
+        error ||= exc
+      end
+      raise error if error
+      loaders.each(&:commit) if commit == :end
+      {row_count: row_count, batch_errors: batch_errors.sort_by!(&:first)}
+    ensure
+      if batches
+        batches.clear
+        batches.close
+      end
+      loaders&.each(&:release)
+    end
+
+    private
+
+    def describe_columns(table, columns)
+      conn = acquire_connection(nil, nil)
+      begin
+        stmt = conn.prepare_stmt("select #{columns.join(', ')} from #{table}")
+        stmt.execute(mode: :describe_only)
+        Array.new(columns.size) { |idx| stmt.query_info(idx + 1) }
+      ensure
+        conn.close
+      end
+    end
+
+    def parallel_query_parts(sql, binds, split_by, parallelism, table)
+      case split_by
+      when :rowid_range, :partition
+        raise ArgumentError, "table is required to split by #{split_by}" if table.nil?
+        sql = "select * from (#{sql}) where rowid between :oracledb_lo and :oracledb_hi"
+        conn = acquire_connection(nil, nil)
+        begin
+          stmt = conn.prepare_stmt(ROWID_RANGES_SQL)
+          stmt.bind_values(num_ranges: split_by == :partition ? 1 : parallelism, table_name: table.to_s.upcase)
+          ranges = []
+          stmt.execute { |row| ranges << row }
+        ensure
+          conn.close
+        end
+        ranges.map do |lo, hi|
+          if binds.is_a? Hash
+            [sql, binds.merge(oracledb_lo: lo, oracledb_hi: hi)]
+          else
+            [sql, (binds || []) + [lo, hi]]
+          end
+        end
+      else
+        mod, column = Array(split_by).flatten
+        raise ArgumentError, "unknown split_by: #{split_by.inspect}" if mod != :mod || column.nil?
+        Array.new(parallelism) do |idx|
+          ["select * from (#{sql}) where mod(abs(trunc(nvl(#{column}, 0))), #{parallelism}) = #{idx}", binds]
+        end
+      end
+    end
+
+    class ParallelWorker
+      include Cancellable
+
+      def initialize(pool, parts, batches, batch_rows)
+        init_cancellable(pool)
+        @thread = Thread.new { run(parts, batches, batch_rows) }
+      end
+
+      private
+
+      def run(parts, batches, batch_rows)
+        while !@cancelled && (part = parts.pop)
+          fetch_part(*part, batches, batch_rows)
+        end
+        batches << :done
+      rescue ClosedQueueError
+        # cancelled
+      rescue => e
+        begin
+          batches << e
+        rescue ClosedQueueError
+        end
+      ensure
+        close_conn
+      end
+
+      def fetch_part(sql, binds, batches, batch_rows)
+        stmt = @conn.prepare_stmt(sql, fetch_array_size: batch_rows)
+        begin
+          stmt.bind_values(binds) if binds
+          batch = []
+          executing do
+            stmt.execute do |row|
+              break if @cancelled
+              batch << row
+              if batch.size >= batch_rows
+                batches << batch
+                batch = []
+              end
+            end
+          end
+          batches << batch unless batch.empty? || @cancelled
+        ensure
+          stmt.close
+        end
+      end
+    end
+    private_constant :ParallelWorker
+
+    class BulkLoader
+      def initialize(pool, sql, column_infos, batches, results, batch_rows, commit_per_batch)
+        @conn = pool.acquire_connection(nil, nil)
+        begin
+          @stmt = @conn.prepare_stmt(sql)
+          # LOB columns are bound as strings.
+          @vars = column_infos.each_with_index.map do |info, idx|
+            @stmt.bind(idx + 1, info, array_size: batch_rows, fetch_lob: false)
+          end
+        rescue Exception
+          @conn.close
+          raise
+        end
+        @mode = [:batch_errors]
+        @mode << :commit_on_success if commit_per_batch
+        @thread = Thread.new { run(batches, results) }
+      end
+
+      def commit
+        @conn.commit
+      end
+
+      def release
+        @thread.join
+        @stmt.close
+        @conn.close
+      end
+
+      private
+
+      def run(batches, results)
+        row_count = 0
+        batch_errors = []
+        while (item = batches.pop)
+          offset, batch = item
+          row_count += execute(batch)
+          @stmt.batch_errors.each do |err|
+            batch_errors << [offset + err.offset, err]
+          end
+        end
+        results << [row_count, batch_errors, nil]
+      rescue => e
+        batches.close
+        results << [row_count, batch_errors, e]
+      end
+
+      def execute(batch)
+        batch.each_with_index do |row, row_idx|
+          @vars.each_with_index do |var, idx|
+            var.set(row_idx, row[idx])
+          end
+        end
+        @stmt.execute_many(batch.size, mode: @mode)
+        @stmt.row_count
+      end
+    end
+    private_constant :BulkLoader
+  end
+
+  # JSON values are fetched as instances of this class by the :lazy
+  # out_filter of JSON variables. The instance keeps a copy of the fetched
+  # data, which stays valid after the next fetch. Use dig or at to convert
+  # only part of the value.
+  class Json
+    # Returns the value as ruby objects. Object field names are interned
+    # strings, or symbols when +symbolize_names+ is true.
+    def value(symbolize_names: false)
+      __value(symbolize_names)
+    end
+  end
+
   class Lob
+    # The default number of LOB chunks read or written at once by
+    # each_chunk, read and write_stream.
+    CHUNKS_PER_CALL = 16
+
     def initialize(conn, type, value = nil)
       __initialize(conn, type)
-      set(value)
+      set(value) if value
     end
 
     def set(value)
@@ -49,24 +512,64 @@ module OracleDB
       @pos = len
     end
 
-    def read(length = nil)
-      return "" if length.zero?
-      len = length
+    # Reads +length+ bytes (characters for CLOBs) from the current
+    # position. When +length+ is nil, it reads until the end chunk by
+    # chunk without getting the LOB size. When +outbuf+ is given, the
+    # data is read into it.
+    def read(length = nil, outbuf = nil)
       if length.nil?
-        len = size - @pos
-        return "" if len <= 0
+        data = nil
+        each_chunk do |chunk|
+          if data
+            data << chunk
+          else
+            data = chunk
+          end
+        end
+        data ||= ""
+        return outbuf ? outbuf.replace(data) : data
+      end
+      if length.zero?
+        return outbuf ? outbuf.clear : ""
       end
-      value, len = __read_bytes(@pos + 1, len)
+      value, len = __read_bytes(@pos + 1, length, outbuf)
       if len > 0
         @pos += len
         value
-      elsif length.nil?
-        ""
       else
         nil
       end
     end
 
+    # Yields data from the current position to the end. Each read ends
+    # at a chunk boundary and reads +bytes+ rounded up to a multiple of
+    # the chunk size. When +outbuf+ is given, it is reused for all
+    # chunks.
+    def each_chunk(bytes: nil, outbuf: nil)
+      return enum_for(__method__, bytes: bytes, outbuf: outbuf) unless block_given?
+      size = chunk_size
+      bytes = stream_bytes(bytes)
+      len = bytes - @pos % size
+      while (data = read(len, outbuf))
+        yield data
+        len = bytes
+      end
+      self
+    end
+
+    # Reads at most +maxlen+ bytes (characters for CLOBs) as IO#readpartial
+    # does. It raises EOFError at the end of the LOB.
+    def readpartial(maxlen, outbuf = nil)
+      data = read(maxlen, outbuf)
+      raise EOFError, "end of file reached" if data.nil?
+      data
+    end
+
+    def eof?
+      @pos >= size
+    end
+    alias eof eof?
+
     def seek(offset, whence = IO::SEEK_SET)
       case whence
       when IO::SEEK_SET, :SET
@@ -81,15 +584,115 @@ module OracleDB
       0
     end
 
+    # Returns the encoding of strings read from and written to CLOBs, or
+    # nil for BLOBs.
+    def external_encoding
+      type == :blob ? nil : Encoding::UTF_8
+    end
+
+    # Writes +value+ at the current position and returns the written
+    # size. Binary strings written to CLOBs, such as chunks passed by
+    # IO.copy_stream, are taken as bytes in the external encoding as
+    # IO#write does. Then an incomplete UTF-8 sequence at the end waits
+    # for the next write and the size is in bytes.
     def write(value)
+      if value.is_a?(String) && value.encoding == Encoding::BINARY && external_encoding
+        data = @write_rest ? @write_rest + value : value
+        len, nbytes = __write_partial(@pos + 1, data)
+        @write_rest = nbytes < data.bytesize ? data.byteslice(nbytes..) : nil
+        @pos += len
+        return value.bytesize
+      end
       len = __write_bytes(@pos + 1, value)
       @pos += len
       len
     end
+
+    # Writes data read from +io+ to the current position in pieces of
+    # +bytes+ rounded up to a multiple of the chunk size. Data for CLOBs
+    # are converted from the external encoding of +io+ to UTF-8.
+    # Returns the written size.
+    def write_stream(io, bytes: nil)
+      bytes = stream_bytes(bytes)
+      ec = text_converter(io)
+      buf = String.new(capacity: bytes)
+      rest = nil
+      written = 0
+      while io.read(bytes, buf)
+        data = ec ? convert_partial(ec, buf) : buf
+        data.prepend(rest) if rest
+        len, nbytes = __write_partial(@pos + 1, data)
+        @pos += len
+        written += len
+        rest = nbytes < data.bytesize ? data.byteslice(nbytes..) : nil
+      end
+      raise EncodingError, "incomplete UTF-8 sequence at the end of the stream" if rest
+      if ec
+        data = ec.finish
+        written += write(data) unless data.empty?
+      end
+      written
+    end
+
+    # Copies data from the current position to the end into +io+. When
+    # +io+ is an IO which needs no encoding conversion, data are passed
+    # through a native buffer to its file descriptor. Otherwise +io+ must
+    # respond to write. Returns the copied size.
+    def copy_to(io, bytes: nil)
+      unless io.is_a?(IO) && text_converter(io).nil?
+        copied = 0
+        each_chunk(bytes: bytes) do |chunk|
+          io.write(chunk)
+          copied += chunk.size
+        end
+        return copied
+      end
+      len = __copy_to_io(io, @pos + 1, stream_bytes(bytes))
+      @pos += len
+      len
+    end
+
+    # Copies data read from +io+ to the current position. It is the
+    # counterpart of copy_to and falls back to write_stream when +io+
+    # isn't an IO or data are buffered in it. Returns the copied size.
+    def copy_from(io, bytes: nil)
+      len = __copy_from_io(io, @pos + 1, stream_bytes(bytes)) if io.is_a?(IO) && text_converter(io).nil?
+      return write_stream(io, bytes: bytes) if len.nil?
+      @pos += len
+      len
+    end
+
+    private
+
+    # Returns a converter from the external encoding of +io+ to UTF-8 when
+    # CLOB data need conversion.
+    def text_converter(io)
+      return nil if external_encoding.nil? || !io.respond_to?(:external_encoding)
+      enc = io.external_encoding
+      return nil if enc.nil? || enc == Encoding::UTF_8 || enc == Encoding::BINARY
+      Encoding::Converter.new(enc, Encoding::UTF_8)
+    end
+
+    # Converts +src+ and keeps an incomplete character at the end in +ec+.
+    def convert_partial(ec, src)
+      dst = String.new
+      raise ec.last_error if ec.primitive_convert(src, dst, nil, nil, partial_input: true) != :source_buffer_empty
+      dst
+    end
+
+    def stream_bytes(bytes)
+      size = chunk_size
+      bytes ? [(bytes + size - 1) / size * size, size].max : size * CHUNKS_PER_CALL
+    end
   end
 
   class Stmt
-    def execute(mode: nil)
+    include Deadline
+
+    attr_accessor :fetch_lobs
+
+    def execute(mode: nil, timeout: nil, &block)
+      return with_deadline(timeout) { execute(mode: mode, &block) } if timeout
       @num_query_columns = __execute(mode)
       if @num_query_columns != 0
         @define_vars = Array.new(@num_query_columns)
@@ -105,6 +708,11 @@ module OracleDB
       nil
     end
 
+    def execute_many(num_iters, mode: nil, timeout: nil)
+      return with_deadline(timeout) { execute_many(num_iters, mode: mode) } if timeout
+      __execute_many(mode, num_iters)
+    end
+
     def bind(key, var = nil, **kw)
       if !var.is_a?(Var)
         var = Var.new(self, var, array_size: @array_size, **kw)
@@ -118,6 +726,16 @@ module OracleDB
       @bind_vars[key] = var
     end
 
+    # Binds ruby values. +values+ is a hash whose keys are bind names
+    # or an array of values bound by position.
+    def bind_values(values)
+      values = values.each_with_index.map { |val, idx| [idx + 1, val] } if values.is_a? Array
+      values.each do |key, val|
+        key = key.to_s if key.is_a? Symbol
+        bind(key, **Var.type_args_for(val)).set(0, val)
+      end
+    end
+
     def define(pos, var = nil, **kw)
       if !var.is_a?(Var)
         var = Var.new(self, var, array_size: @array_size, **kw)
@@ -127,38 +745,127 @@ module OracleDB
     end
 
     def fetch
-      if !@defined && @num_query_columns != 0
-        @define_vars.each_index do |idx|
-          if @define_vars[idx].nil?
-            define(idx + 1, query_info(idx + 1))
-          end
-        end
-      end
+      define_columns
       buffer_row_index = __fetch
       buffer_row_index && @define_vars.map do |var|
         var.get(buffer_row_index)
       end
     end
 
+    # Fetches rowids in column +pos+ of up to +max_rows+ rows as one
+    # string of space-padded +width+-byte values. Returns nil when no
+    # rows remain. UROWID values, such as rowids of index-organized
+    # tables, are longer than Rowid::SIZE and need a larger +width+.
+    # ArgumentError is raised for rowids longer than +width+.
+    def fetch_rowids(pos = 1, max_rows = fetch_array_size, width: Rowid::SIZE)
+      define_columns
+      buffer_row_index, num_rows = __fetch_rows(max_rows)
+      return nil if num_rows == 0
+      @define_vars[pos - 1].get_rowids(buffer_row_index, num_rows, width)
+    end
+
+    # Binds rowids returned by fetch_rowids with the same +width+ as an
+    # array for execute_many and returns the number of rowids.
+    def bind_rowids(key, rowids, width: Rowid::SIZE)
+      key = key.to_s if key.is_a? Symbol
+      num_rows = rowids.bytesize / width
+      var = bind(key, array_size: [num_rows, 1].max, oracle_type: :varchar, native_type: :bytes, size: width)
+      var.set_rowids(0, rowids, width)
+    end
+
     def info
       @info ||= __info
       @info
     end
+
+    private
+
+    def define_columns
+      if !@defined && @num_query_columns != 0
+        raise RuntimeError, "the statement must be executed before fetching rows" if @define_vars.nil?
+        @define_vars.each_index do |idx|
+          if @define_vars[idx].nil?
+            define(idx + 1, query_info(idx + 1), fetch_lob: @fetch_lobs != false)
+          end
+        end
+      end
+    end
+
+    # Columns defined out of ruby are redefined by the next execute.
+    def reset_defines
+      @num_query_columns = nil
+      @define_vars = nil
+    end
   end
 
   class Var
-    def initialize(conn, info = nil, array_size:, oracle_type: nil, native_type: nil, size: nil, size_is_bytes: nil, is_array: nil, object_type: nil, out_filter: nil, in_filter: nil)
+    # Longer strings are bound as LONG or LONG RAW, which can be
+    # inserted into LOB columns.
+    MAX_STRING_BIND_SIZE = 4000
+
+    # LOB types fetched as strings when +fetch_lob+ is false. NCLOB isn't
+    # included because it would be fetched as LONG, which goes through
+    # the database character set and may corrupt national character data.
+    INLINE_LOB_TYPES = [:clob, :blob].freeze
+    private_constant :INLINE_LOB_TYPES
+
+    # When +fetch_lob+ is false and +info+ or +oracle_type+ is CLOB or
+    # BLOB, values are fetched and bound as strings.
+    def initialize(conn, info = nil, array_size:, oracle_type: nil, native_type: nil, size: nil, size_is_bytes: nil, is_array: nil, object_type: nil, out_filter: nil, in_filter: nil, fetch_lob: true)
       info = info.type_info if info.respond_to? :type_info
       if info
         oracle_type = info.oracle_type if oracle_type.nil?
+        native_type = :bytes if native_type.nil? && !fetch_lob && INLINE_LOB_TYPES.include?(oracle_type)
         native_type = oracle_type != :number ? info.default_native_type : :bytes if native_type.nil?
         size = info.client_size_in_bytes if size.nil?
         size_is_bytes = true if size_is_bytes.nil?
         is_array = false if is_array.nil?
         object_type = info.object_type if object_type.nil?
       end
+      if !fetch_lob && native_type == :bytes && INLINE_LOB_TYPES.include?(oracle_type)
+        # Strings are fetched from and bound to LOB columns as LONG or
+        # LONG RAW. Neither needs LOB locators nor temporary LOBs.
+        oracle_type = oracle_type == :blob ? :long_raw : :long_varchar
+      end
       __initialize(conn, oracle_type, native_type, array_size, size, size_is_bytes, is_array, object_type, out_filter, in_filter)
     end
+
+    # Returns keyword arguments of Var.new suitable for +value+.
+    def self.type_args_for(value)
+      case value
+      when Integer
+        {oracle_type: :number, native_type: :int64}
+      when Float
+        {oracle_type: :native_double, native_type: :double}
+      when Rational
+        {oracle_type: :number, native_type: :bytes}
+      when String
+        binary = value.encoding == Encoding::BINARY
+        if value.bytesize > MAX_STRING_BIND_SIZE
+          {oracle_type: binary ? :long_raw : :long_varchar, native_type: :bytes}
+        else
+          {oracle_type: binary ? :raw : :varchar, native_type: :bytes, size: [value.bytesize, 1].max}
+        end
+      when true, false
+        {oracle_type: :boolean, native_type: :boolean}
+      when Timestamp
+        {oracle_type: :timestamp, native_type: :timestamp}
+      when IntervalDS
+        {oracle_type: :interval_ds, native_type: :interval_ds}
+      when IntervalYM
+        {oracle_type: :interval_ym, native_type: :interval_ym}
+      when Rowid
+        {oracle_type: :rowid, native_type: :rowid}
+      when nil
+        {oracle_type: :varchar, native_type: :bytes, size: 1}
+      else
+        # BigDecimal is bound as text of NUMBER to keep the precision.
+        return {oracle_type: :number, native_type: :bytes} if defined?(::BigDecimal) && value.is_a?(::BigDecimal)
+        # Vector is defined only when ODPI-C supports VECTOR.
+        return {oracle_type: :vector, native_type: :vector} if defined?(OracleDB::Vector) && value.is_a?(OracleDB::Vector)
+        raise ArgumentError, "unsupported bind value type: #{value.class}"
+      end
+    end
   end
 
   class ObjectType
@@ -191,6 +898,25 @@ module OracleDB
     end
   end
 
+  if const_defined?(:Vector, false)
+    class Vector
+      def ==(other)
+        other.is_a?(Vector) && format == other.format && data == other.data
+      end
+      alias eql? ==
+
+      def hash
+        [format, data].hash
+      end
+
+      def inspect
+        "#<#{self.class}:#{format}[#{num_dimensions}]>"
+      rescue
+        "#<#{self.class}:ERROR: #{$!.message}>"
+      end
+    end
+  end
+
   class Rowid
     def inspect
       "#<#{self.class}:#{self.to_s}>"
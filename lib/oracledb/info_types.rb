@@ -41,6 +41,16 @@ module OracleDB
       @object_type
     end
 
+    # The number of dimensions of a VECTOR column or nil if flexible.
+    def vector_dimensions
+      @vector_dimensions
+    end
+
+    # The format of a VECTOR column or nil if flexible.
+    def vector_format
+      @vector_format
+    end
+
     def to_s
       case @oracle_type
       when :varchar
@@ -129,6 +139,8 @@ module OracleDB
         "LONG RAW"
       when :json
         "JSON"
+      when :vector
+        "VECTOR(#{@vector_dimensions || '*'}, #{(@vector_format || '*').to_s.upcase})"
       else
         @oracle_type.to_s
       end
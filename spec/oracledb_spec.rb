@@ -2,6 +2,61 @@ RSpec.describe OracleDB do
   it "has a version number" do
     expect(OracleDB::VERSION).not_to be nil
   end
+
+  it "copies rows between connections" do
+    src = connect
+    dst = connect
+    dst.prepare_stmt("truncate table TestTempTable").execute
+    stmt = src.prepare_stmt("select level, 'String ' || level from dual connect by level <= 1000")
+    count = OracleDB.copy(from: stmt, to: dst, insert_sql: "insert into TestTempTable (IntCol, StringCol) values (:1, :2)", batch_rows: 64)
+    expect(count).to eq 1000
+    dst.commit
+    expect{stmt.fetch}.to raise_error(RuntimeError, /must be executed/)
+    stmt.execute
+    expect(stmt.fetch).to eq ["1", "String 1"]
+    stmt = src.prepare_stmt("select count(*) from TestTempTable")
+    stmt.execute
+    expect(stmt.fetch[0].to_i).to eq 1000
+  end
+
+  it "copies LOBs as LONG and rowids as strings" do
+    src = connect
+    dst = connect
+    dst.prepare_stmt("truncate table TestCLOBs").execute
+    stmt = src.prepare_stmt("select level, to_clob(rpad('x', 4000, 'x')) || rpad('y', 1000, 'y') from dual connect by level <= 3")
+    count = OracleDB.copy(from: stmt, to: dst, insert_sql: "insert into TestCLOBs (IntCol, CLOBCol) values (:1, :2)")
+    expect(count).to eq 3
+    dst.commit
+    dst.prepare_stmt("truncate table TestTempTable").execute
+    stmt = src.prepare_stmt("select IntCol, rowid from TestCLOBs where dbms_lob.getlength(CLOBCol) = 5000")
+    count = OracleDB.copy(from: stmt, to: dst, insert_sql: "insert into TestTempTable (IntCol, StringCol) values (:1, :2)")
+    expect(count).to eq 3
+    dst.commit
+    stmt = src.prepare_stmt("select count(*) from TestTempTable t, TestCLOBs c where t.IntCol = c.IntCol and t.StringCol = rowidtochar(c.rowid)")
+    stmt.execute
+    expect(stmt.fetch[0].to_i).to eq 3
+  end
+
+  it "enforces deadlines of the connections while copying rows" do
+    src = connect
+    dst = connect
+    dst.prepare_stmt("truncate table TestTempTable").execute
+    stmt = src.prepare_stmt("select level, 'String ' || level from dual connect by level <= 1000000000")
+    started = Time.now
+    src.with_deadline(1) do
+      expect{OracleDB.copy(from: stmt, to: dst, insert_sql: "insert into TestTempTable (IntCol, StringCol) values (:1, :2)")}.to raise_error(OracleDB::TimeoutError)
+    end
+    expect(Time.now - started).to be < 30
+    dst.rollback
+    expect(src.ping).to be_nil
+    expect(dst.ping).to be_nil
+  end
+
+  it "raises TypeError when the copy destination isn't a connection" do
+    stmt = connect.prepare_stmt("select * from dual")
+    expect{OracleDB.copy(from: stmt, to: stmt, insert_sql: "insert into TestTempTable (IntCol) values (:1)")}.to raise_error(TypeError)
+    expect{OracleDB.copy(from: nil, to: connect, insert_sql: "insert into TestTempTable (IntCol) values (:1)")}.to raise_error(TypeError)
+  end
 end
 
 RSpec.describe OracleDB::Context do
@@ -130,6 +185,390 @@ RSpec.describe OracleDB::Stmt do
     stmt.define(1, array_size: 100, oracle_type: :timestamp, native_type: :timestamp, out_filter: Proc.new {|x| x.to_s})
     expect(stmt.fetch[0]).to eq '2021-02-03 04:05:06.789012345 +00:00'
   end
+
+  it "converts values with native filters" do
+    conn = connect
+    stmt = conn.prepare_stmt("select 'Y', ' ab ', '1.25', to_date('2021-02-03 04:05:06', 'YYYY-MM-DD HH24:MI:SS') from dual")
+    stmt.execute
+    stmt.define(1, oracle_type: :varchar, native_type: :bytes, size: 1, out_filter: :to_bool_yn)
+    stmt.define(2, oracle_type: :varchar, native_type: :bytes, size: 4, out_filter: :strip)
+    stmt.define(3, oracle_type: :varchar, native_type: :bytes, size: 4, out_filter: :to_bigdecimal)
+    stmt.define(4, oracle_type: :date, native_type: :timestamp, out_filter: :to_time)
+    expect(stmt.fetch).to eq [true, "ab", BigDecimal("1.25"), Time.local(2021, 2, 3, 4, 5, 6)]
+
+    stmt = conn.prepare_stmt("select :1 from dual")
+    stmt.bind(1, oracle_type: :varchar, native_type: :bytes, size: 1, in_filter: :to_bool_yn).set(0, false)
+    stmt.execute
+    stmt.define(1, oracle_type: :varchar, native_type: :bytes, size: 1, out_filter: :dedup)
+    value = stmt.fetch[0]
+    expect(value).to eq "N"
+    expect(value).to be_frozen
+  end
+
+  it "fetches and binds exact decimal numbers" do
+    conn = connect
+    stmt = conn.prepare_stmt("select 12345678901234567890.123456789, 10, 0.5 from dual")
+    stmt.execute
+    stmt.define(1, oracle_type: :number, native_type: :bytes, out_filter: :bigdecimal)
+    # NUMBER values are fetched as strings unless an out_filter is given.
+    expect(stmt.fetch).to eq [BigDecimal("12345678901234567890.123456789"), "10", "0.5"]
+
+    stmt = conn.prepare_stmt("select :1 + 0, :2 * 3 from dual")
+    stmt.bind_values([BigDecimal("0.1"), Rational(1, 4)])
+    stmt.execute
+    stmt.define(1, oracle_type: :number, native_type: :bytes, out_filter: :bigdecimal)
+    stmt.define(2, oracle_type: :number, native_type: :bytes, out_filter: :bigdecimal)
+    row = stmt.fetch
+    expect(row[0]).to eq BigDecimal("0.1")
+    expect(row[1]).to eq BigDecimal("0.75")
+  end
+
+  it "fetches NVARCHAR values as strings" do
+    conn = connect
+    stmt = conn.prepare_stmt("select to_nchar('abc'), to_nchar('1.5') from dual")
+    stmt.execute
+    expect(stmt.fetch).to eq ["abc", "1.5"]
+  end
+
+  it "converts strings to and from UTF-8" do
+    conn = connect
+    stmt = conn.prepare_stmt("select :1, :2 from dual")
+    stmt.bind_values(["caf\u00e9".encode("ISO-8859-1"), "abc".b])
+    stmt.execute
+    row = stmt.fetch
+    expect(row).to eq ["caf\u00e9", "abc"]
+    expect(row[0].encoding).to eq Encoding::UTF_8
+    expect(row[0]).to be_valid_encoding
+  end
+
+  it "shares fetched strings in a column with :column_dedup" do
+    conn = connect
+    stmt = conn.prepare_stmt("select decode(mod(level, 2), 0, 'even', 'odd') from dual connect by level <= 4")
+    stmt.execute
+    stmt.define(1, oracle_type: :varchar, native_type: :bytes, size: 4, out_filter: :column_dedup)
+    rows = 4.times.map { stmt.fetch[0] }
+    expect(rows).to eq ["odd", "even", "odd", "even"]
+    expect(rows[0]).to be_frozen
+    expect(rows[0]).to equal rows[2]
+    expect(rows[1]).to equal rows[3]
+  end
+
+  it "converts timestamps with native filters" do
+    conn = connect
+    stmt = conn.prepare_stmt("select d, d, d, d from (select to_date('2021-02-03 04:05:06', 'YYYY-MM-DD HH24:MI:SS') d from dual)")
+    stmt.execute
+    stmt.define(1, oracle_type: :date, native_type: :timestamp, out_filter: :to_time)
+    stmt.define(2, oracle_type: :date, native_type: :timestamp, out_filter: :to_utc_time)
+    stmt.define(3, oracle_type: :date, native_type: :timestamp, out_filter: :epoch_ms)
+    stmt.define(4, oracle_type: :date, native_type: :timestamp, out_filter: :epoch_ns)
+    time = Time.local(2021, 2, 3, 4, 5, 6)
+    row = stmt.fetch
+    expect(row[0]).to eq time
+    expect(row[1]).to eq Time.utc(2021, 2, 3, 4, 5, 6)
+    expect(row[1]).to be_utc
+    expect(row[2]).to eq time.to_i * 1000
+    expect(row[3]).to eq time.to_i * 1000000000
+  end
+
+  it "converts timestamps with the TZ in effect" do
+    conn = connect
+    stmt = conn.prepare_stmt("select to_date('2021-02-03 04:05:06', 'YYYY-MM-DD HH24:MI:SS') from dual")
+    tz = ENV["TZ"]
+    begin
+      ["UTC", "Asia/Tokyo"].each do |zone|
+        ENV["TZ"] = zone
+        stmt.execute
+        stmt.define(1, oracle_type: :date, native_type: :timestamp, out_filter: :to_time)
+        expect(stmt.fetch[0]).to eq Time.local(2021, 2, 3, 4, 5, 6)
+      end
+    ensure
+      ENV["TZ"] = tz
+    end
+  end
+
+  it "fetches rowids in bulk and binds them by array DML" do
+    conn = connect
+    conn.prepare_stmt("truncate table TestCLOBs").execute
+    conn.prepare_stmt("insert into TestCLOBs (IntCol) select level from dual connect by level <= 3").execute
+    stmt = conn.prepare_stmt("select rowid, IntCol from TestCLOBs order by IntCol")
+    stmt.execute
+    row = stmt.fetch
+    expect(row[0].to_s).to equal row[0].to_s
+    expect(row[0].to_s.bytesize).to eq OracleDB::Rowid::SIZE
+    rowids = stmt.fetch_rowids(1, 100)
+    expect(rowids.bytesize).to eq 2 * OracleDB::Rowid::SIZE
+
+    stmt = conn.prepare_stmt("update TestCLOBs set IntCol = IntCol where rowid = :r")
+    num_rows = stmt.bind_rowids(:r, row[0].to_s + rowids)
+    stmt.execute_many(num_rows)
+    expect(stmt.row_count).to eq 3
+    conn.rollback
+  end
+
+  it "fetches and binds rowids of index-organized tables by a larger width" do
+    conn = connect
+    conn.prepare_stmt("create table RbOraDBIotTest (id varchar2(100) primary key, name varchar2(10)) organization index").execute
+    begin
+      conn.prepare_stmt("insert into RbOraDBIotTest select rpad(level, 50, 'x'), 'x' from dual connect by level <= 3").execute
+      stmt = conn.prepare_stmt("select rowid from RbOraDBIotTest order by id")
+      stmt.execute
+      expect{stmt.fetch_rowids(1, 100)}.to raise_error(ArgumentError, /longer than the width/)
+      stmt.execute
+      rowids = stmt.fetch_rowids(1, 100, width: 4000)
+      expect(rowids.bytesize).to eq 3 * 4000
+
+      stmt = conn.prepare_stmt("update RbOraDBIotTest set name = 'y' where rowid = :r")
+      num_rows = stmt.bind_rowids(:r, rowids, width: 4000)
+      stmt.execute_many(num_rows)
+      expect(stmt.row_count).to eq 3
+    ensure
+      conn.prepare_stmt("drop table RbOraDBIotTest purge").execute
+    end
+  end
+
+  it "fetches LOBs as strings" do
+    conn = connect
+    sql = "select to_clob('clob value'), to_blob(hextoraw('0102')), to_nclob('nclob value') from dual"
+    stmt = conn.prepare_stmt(sql, fetch_lobs: false)
+    stmt.execute
+    row = stmt.fetch
+    expect(row[0, 2]).to eq ["clob value", "\x01\x02".b]
+    expect(row[2]).to be_a_kind_of OracleDB::Lob
+    stmt = conn.prepare_stmt(sql)
+    stmt.execute
+    stmt.define(1, stmt.query_info(1), fetch_lob: false)
+    row = stmt.fetch
+    expect(row[0]).to eq "clob value"
+    expect(row[1]).to be_a_kind_of OracleDB::Lob
+  end
+
+  it "raises TimeoutError when the deadline passes" do
+    conn = connect
+    stmt = conn.prepare_stmt("begin dbms_session.sleep(3); end;")
+    expect{stmt.execute(timeout: 0.5)}.to raise_error(OracleDB::TimeoutError, /^ORA-01013:/)
+    stmt = conn.prepare_stmt("select * from dual")
+    expect(conn.with_deadline(3) { stmt.execute { |row| expect(row).to eq ["X"] } }).to eq 1
+  end
+
+  it "doesn't break idle connections when the deadline passes" do
+    conn = connect
+    stmt = conn.prepare_stmt("select * from dual")
+    expect{conn.with_deadline(0.1) { sleep 0.5; stmt.execute }}.to raise_error(OracleDB::TimeoutError, /^ORA-01013:/)
+    conn.with_deadline(0.1) { sleep 0.5 }
+    expect{conn.prepare_stmt("select 1 from nonexistent_table").execute}.to raise_error(OracleDB::Error) { |e|
+      expect(e).not_to be_a_kind_of OracleDB::TimeoutError
+    }
+    expect(stmt.execute { |row| expect(row).to eq ["X"] }).to eq 1
+  end
+
+  it "enforces deadlines in a child process forked with a pending deadline" do
+    skip "fork is unavailable" unless Process.respond_to?(:fork)
+    conn = connect
+    conn.with_deadline(60) do
+      pid = fork do
+        child = connect
+        stmt = child.prepare_stmt("begin dbms_session.sleep(3); end;")
+        begin
+          stmt.execute(timeout: 0.5)
+          exit! 1
+        rescue OracleDB::TimeoutError
+          exit! 0
+        end
+      end
+      Process.wait(pid)
+      expect($?.exitstatus).to eq 0
+    end
+  end
+end
+
+RSpec.describe OracleDB::Pool do
+  it "runs hedged queries" do
+    pool = OracleDB::Pool.new($ctxt, $main_username, $main_password, $connect_string, {max_sessions: 2})
+    expect(pool.hedged_query("select :1 from dual", ["X"], hedge_after: 0)).to eq [["X"]]
+    expect{pool.hedged_query("delete from dual")}.to raise_error(ArgumentError)
+  end
+
+  it "runs parallel queries" do
+    pool = OracleDB::Pool.new($ctxt, $main_username, $main_password, $connect_string, {max_sessions: 4})
+    sql = "select level from dual connect by level <= 1000"
+    rows = []
+    pool.parallel_query(sql, split_by: [:mod, "level"], parallelism: 4, batch_rows: 50) { |batch| rows.concat(batch) }
+    expect(rows.map(&:first).map(&:to_i).sort).to eq (1..1000).to_a
+    sql = "select case when level > 10 then level - 500 end n from dual connect by level <= 1000"
+    rows = pool.parallel_query(sql, split_by: [:mod, "n"], parallelism: 4).flat_map(&:itself)
+    expect(rows.size).to eq 1000
+    expect(rows.map(&:first).compact.map(&:to_i).sort).to eq (-489..500).to_a
+  end
+
+  it "loads rows in bulk" do
+    pool = OracleDB::Pool.new($ctxt, $main_username, $main_password, $connect_string, {max_sessions: 2})
+    conn = connect
+    conn.prepare_stmt("truncate table TestTempTable").execute
+    rows = (1..1000).map { |i| [i, "String #{i}"] }
+    result = pool.bulk_load("TestTempTable", ["IntCol", "StringCol"], rows, sessions: 2, batch_rows: 100, append_hint: false, commit: :end)
+    expect(result).to eq({row_count: 1000, batch_errors: []})
+    stmt = conn.prepare_stmt("select count(*) from TestTempTable")
+    stmt.execute
+    expect(stmt.fetch[0].to_i).to eq 1000
+  end
+
+  it "loads rows whose values don't fit the types in the first batch" do
+    pool = OracleDB::Pool.new($ctxt, $main_username, $main_password, $connect_string, {max_sessions: 2})
+    conn = connect
+    conn.prepare_stmt("truncate table TestTempTable").execute
+    rows = (1..300).map { |i| [i, i <= 100 ? nil : "x" * (i - 100)] }
+    result = pool.bulk_load("TestTempTable", ["IntCol", "StringCol"], rows, sessions: 2, batch_rows: 100)
+    expect(result).to eq({row_count: 300, batch_errors: []})
+    stmt = conn.prepare_stmt("select count(StringCol), max(length(StringCol)) from TestTempTable")
+    stmt.execute
+    expect(stmt.fetch.map(&:to_i)).to eq [200, 200]
+  end
+end
+
+RSpec.describe OracleDB::Json do
+  it "fetches JSON object field names as interned strings or symbols" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json('[{\"a\":1},{\"a\":2}]'), json('{\"b\":[true]}') from dual")
+    stmt.execute
+    stmt.define(2, oracle_type: :json, native_type: :json, out_filter: :symbolize_names)
+    row = stmt.fetch
+    expect(row[0]).to eq [{"a" => 1}, {"a" => 2}]
+    expect(row[0][0].keys[0]).to equal row[0][1].keys[0]
+    expect(row[0][0].keys[0]).to be_frozen
+    expect(row[1]).to eq({b: [true]})
+  end
+
+  it "fetches JSON values as JSON text" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json('{\"a\":[1,2.5,\"x\\\"y\",null,true]}') from dual")
+    stmt.execute
+    stmt.define(1, oracle_type: :json, native_type: :json, out_filter: :to_json)
+    expect(stmt.fetch).to eq ['{"a":[1,2.5,"x\\"y",null,true]}']
+  end
+
+  it "extracts parts of JSON values" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json('{\"a\":{\"b c\":[10,{\"d\":\"x\"}]},\"e\":1}') from dual")
+    stmt.execute
+    stmt.define(1, oracle_type: :json, native_type: :json, out_filter: :lazy)
+    json = stmt.fetch[0]
+    expect(json).to be_a_kind_of OracleDB::Json
+    expect(json.dig("a", :"b c", -1, "d")).to eq "x"
+    expect(json.dig("a", "z")).to be nil
+    expect(json.at('$.a."b c"[0]')).to eq 10
+    expect(json.at("$['e']")).to eq 1
+    expect { json.at("$.a[*]") }.to raise_error ArgumentError
+  end
+
+  it "keeps JSON values fetched by the :lazy out_filter after the next fetch" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json_object('n' value level) from dual connect by level <= 3", fetch_array_size: 1)
+    stmt.execute
+    stmt.define(1, oracle_type: :json, native_type: :json, out_filter: :lazy)
+    rows = []
+    while row = stmt.fetch
+      rows << row[0]
+    end
+    expect(rows.map { |json| json.dig("n") }).to eq [1, 2, 3]
+  end
+
+  it "binds JSON text as JSON values" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json_serialize(:1) from dual")
+    stmt.bind(1, oracle_type: :json, native_type: :json, in_filter: :from_json).set(0, ' {"a": [1, "\\u00e9", null]} ')
+    stmt.execute
+    expect(stmt.fetch).to eq ['{"a":[1,"\u00e9",null]}']
+    expect { stmt.bind(1, oracle_type: :json, native_type: :json, in_filter: :from_json).set(0, "[1,]") }.to raise_error ArgumentError
+  end
+
+  it "binds ruby objects as JSON values" do
+    conn = connect
+    stmt = conn.prepare_stmt("select json_serialize(:1) from dual")
+    value = {a: [1, 2**70, "x"], "b" => {"c" => "\u00e9".encode("ISO-8859-1")}}
+    stmt.bind(1, oracle_type: :json, native_type: :json).set(0, value)
+    stmt.execute
+    expect(stmt.fetch).to eq ['{"a":[1,1180591620717411303424,"x"],"b":{"c":"\u00e9"}}']
+  end
+end
+
+RSpec.describe OracleDB::Lob do
+  it "reads and writes data in chunks" do
+    conn = connect
+    lob = conn.new_tmp_lob(:blob)
+    data = Random.new.bytes(100_000)
+    expect(lob.write_stream(StringIO.new(data))).to eq data.bytesize
+    lob.seek(0)
+    expect(lob.each_chunk(bytes: 10_000).to_a.join).to eq data
+    lob.seek(0)
+    buf = String.new
+    expect(lob.read(10, buf)).to equal buf
+    expect(buf).to eq data[0, 10]
+    expect(lob.read).to eq data[10..]
+  end
+
+  it "binds strings to LOB columns by array DML" do
+    conn = connect
+    conn.prepare_stmt("truncate table TestCLOBs").execute
+    stmt = conn.prepare_stmt("insert into TestCLOBs (IntCol, CLOBCol) values (:1, :2)")
+    ints = stmt.bind(1, array_size: 3, oracle_type: :number, native_type: :int64)
+    clobs = stmt.bind(2, array_size: 3, oracle_type: :clob, native_type: :bytes, fetch_lob: false)
+    3.times do |idx|
+      ints.set(idx, idx + 1)
+      clobs.set(idx, "x" * (10_000 * (idx + 1)))
+    end
+    stmt.execute_many(3)
+    stmt = conn.prepare_stmt("select dbms_lob.getlength(CLOBCol) from TestCLOBs order by IntCol")
+    lengths = []
+    stmt.execute { |row| lengths << row[0].to_i }
+    expect(lengths).to eq [10_000, 20_000, 30_000]
+  end
+
+  it "reuses temporary LOBs" do
+    conn = connect
+    lob = conn.new_tmp_lob(:clob, "value")
+    conn.release_tmp_lob(lob)
+    expect(conn.new_tmp_lob(:clob)).to equal lob
+    expect(lob.read).to eq ""
+  end
+
+  it "copies data between LOBs and IO objects" do
+    conn = connect
+    data = Random.new.bytes(100_000)
+    lob = conn.new_tmp_lob(:blob)
+    Tempfile.create("lob", binmode: true) do |file|
+      file.write(data)
+      file.rewind
+      expect(lob.copy_from(file)).to eq data.bytesize
+      file.rewind
+      file.truncate(0)
+      lob.seek(0)
+      expect(lob.copy_to(file)).to eq data.bytesize
+      expect(lob.eof?).to be true
+      file.rewind
+      expect(file.read).to eq data
+    end
+    lob.seek(0)
+    expect(IO.copy_stream(lob, out = StringIO.new(String.new))).to eq data.bytesize
+    expect(out.string).to eq data
+    expect { lob.readpartial(10) }.to raise_error EOFError
+  end
+
+  it "copies text through IO.copy_stream and non-blocking pipes" do
+    conn = connect
+    text = "\u00e9\u3042x" * 20_000
+    lob = conn.new_tmp_lob(:clob)
+    expect(IO.copy_stream(StringIO.new(text.b), lob)).to eq text.bytesize
+    lob.seek(0)
+    r, w = IO.pipe
+    reader = Thread.new { r.read }
+    expect(lob.copy_to(w)).to eq text.size
+    w.close
+    expect(reader.value.force_encoding(Encoding::UTF_8)).to eq text
+    lob = conn.new_tmp_lob(:clob)
+    expect(lob.write_stream(StringIO.new(text.encode(Encoding::UTF_16LE)))).to eq text.size
+    lob.seek(0)
+    expect(lob.read).to eq text
+  end
 end
 
 RSpec.describe OracleDB::ObjectType do
@@ -168,6 +607,116 @@ RSpec.describe OracleDB::ObjectType do
   end
 end
 
+RSpec.describe OracleDB::Object do
+  it "gets and sets attribute and element values" do
+    conn = connect
+    objtype = conn.object_type("UDT_OBJECTDATATYPES")
+    expect(conn.object_type("UDT_OBJECTDATATYPES")).to equal objtype
+    obj = objtype.new_object
+    attrs = objtype.attributes.to_h { |attr| [attr.name, attr] }
+    obj.set_attribute_value(attrs["STRINGCOL"], "abc")
+    obj.set_attribute_value(attrs["INTCOL"], 10)
+    expect(obj.attribute_value(attrs["STRINGCOL"])).to eq "abc"
+    expect(obj.attribute_value(attrs["INTCOL"])).to eq "10"
+    expect(obj.attribute_value(attrs["DATECOL"])).to be nil
+    expect { obj.append_element(1) }.to raise_error ArgumentError
+  end
+
+  it "converts objects from and to arrays and hashes" do
+    conn = connect
+    objtype = conn.object_type("UDT_OBJECTARRAY")
+    values = [
+      {"SUBNUMBERVALUE" => nil, "SUBSTRINGVALUE" => "one"},
+      {"SUBNUMBERVALUE" => nil, "SUBSTRINGVALUE" => nil},
+    ]
+    obj = objtype.from_array(values)
+    expect(obj.size).to eq 2
+    expect(obj.to_a).to eq values
+    expect(obj.to_h).to eq({0 => values[0], 1 => values[1]})
+
+    subobj = conn.object_type("UDT_SUBOBJECT").from_hash(substringvalue: "three")
+    expect(subobj.to_h).to eq({"SUBNUMBERVALUE" => nil, "SUBSTRINGVALUE" => "three"})
+    expect { subobj.to_a }.to raise_error ArgumentError
+  end
+
+  it "converts objects from and to structs" do
+    conn = connect
+    objtype = conn.object_type("UDT_SUBOBJECT")
+    klass = objtype.ruby_class
+    expect(klass.members).to eq [:subnumbervalue, :substringvalue]
+    expect(conn.object_type("UDT_OBJECTARRAY").ruby_class).to be nil
+
+    stmt = conn.prepare_stmt("begin :1 := :2; end;")
+    out = stmt.bind(1, oracle_type: :object, native_type: :object, object_type: objtype, out_filter: :to_struct)
+    stmt.bind(2, oracle_type: :object, native_type: :object, object_type: objtype).set(0, klass.new(nil, "four"))
+    stmt.execute
+    expect(out.get(0)).to eq klass.new(nil, "four")
+    expect(objtype.from_hash(substringvalue: "five").to_struct).to eq klass.new(nil, "five")
+  end
+
+  it "uses struct classes matching the attributes of altered types" do
+    conn = connect
+    conn.prepare_stmt("create or replace type RbOraDBStructTest as object (a number)").execute
+    begin
+      expect(conn.object_type("RBORADBSTRUCTTEST").ruby_class.members).to eq [:a]
+      conn.prepare_stmt("create or replace type RbOraDBStructTest as object (a number, b varchar2(10))").execute
+      expect(connect.object_type("RBORADBSTRUCTTEST").ruby_class.members).to eq [:a, :b]
+    ensure
+      conn.prepare_stmt("drop type RbOraDBStructTest").execute
+    end
+  end
+end
+
+RSpec.describe "OracleDB::Vector" do
+  it "fetches and binds vectors as packed elements" do
+    skip "ODPI-C doesn't support VECTOR" unless defined? OracleDB::Vector
+    conn = connect
+    stmt = conn.prepare_stmt("select to_vector('[1.5, -2, 3.25]', 3, FLOAT32) from dual")
+    stmt.execute
+    expect(stmt.query_info(1).type_info.to_s).to eq "VECTOR(3, FLOAT32)"
+    vec = stmt.fetch[0]
+    expect(vec.format).to eq :float32
+    expect(vec.num_dimensions).to eq 3
+    expect(vec.data).to eq [1.5, -2.0, 3.25].pack("f*")
+    expect(vec.to_a).to eq [1.5, -2.0, 3.25]
+
+    stmt = conn.prepare_stmt("select :1 from dual")
+    stmt.bind_values([OracleDB::Vector.new(:int8, [1, -1, 127])])
+    stmt.execute
+    expect(stmt.fetch[0]).to eq OracleDB::Vector.new(:int8, [1, -1, 127].pack("c*"))
+  end
+
+  it "raises RuntimeError on uninitialized vectors" do
+    skip "ODPI-C doesn't support VECTOR" unless defined? OracleDB::Vector
+    vec = OracleDB::Vector.allocate
+    expect{vec.to_a}.to raise_error(RuntimeError, /uninitialized/)
+    expect{vec.format}.to raise_error(RuntimeError, /uninitialized/)
+    expect{vec.num_dimensions}.to raise_error(RuntimeError, /uninitialized/)
+    expect{vec.data}.to raise_error(RuntimeError, /uninitialized/)
+  end
+end
+
+RSpec.describe "OracleDB typed data" do
+  it "reports memory sizes and survives compaction" do
+    require "objspace"
+    conn = connect
+    small = OracleDB::Var.new(conn, array_size: 1, oracle_type: :varchar, native_type: :bytes, size: 100)
+    large = OracleDB::Var.new(conn, array_size: 1000, oracle_type: :varchar, native_type: :bytes, size: 100)
+    expect(ObjectSpace.memsize_of(conn)).to be > 0
+    expect(ObjectSpace.memsize_of(large)).to be >= ObjectSpace.memsize_of(small) + 999 * 100
+
+    stmt = conn.prepare_stmt("select :1 || 'def' from dual")
+    stmt.bind(1, large)
+    large.set(0, "abc")
+    skip "GC.compact isn't supported" unless GC.respond_to?(:compact)
+    GC.compact
+    expect(large.get(0)).to eq "abc"
+    stmt.execute
+    expect(stmt.fetch).to eq ["abcdef"]
+    expect(conn.ping).to be_nil
+  end
+end
+
 RSpec.describe OracleDB::Soda::Db do
   it "gets db" do
     db = connect.soda_db
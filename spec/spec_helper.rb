@@ -1,5 +1,8 @@
 require "bundler/setup"
 require "oracledb"
+require "bigdecimal"
+require "stringio"
+require "tempfile"
 
 RSpec.configure do |config|
   # Enable flags like --only-failures and --next-failure